@@ -0,0 +1,1211 @@
+#include "compressionengine.h"
+#include "encoderbackend.h"
+#include "joblog.h"
+#include "mp4probe.h"
+#include <QStandardPaths>
+#include <QDateTime>
+#include <QFileInfo>
+#include <QDir>
+#include <QFile>
+#include <QDebug>
+#include <QStorageInfo>
+#include <QThread>
+#include <QtMath>
+#include <QTimer>
+#include <QTextStream>
+#include <QPointer>
+
+//Number of lines of the log shown when ffmpeg fails
+static const int errorTailLines = 4;
+
+//Log files kept in the cache, one is made for every video
+static const int keptLogFiles = 500;
+
+//Under this length, decoding the video twice costs too little to bother with an intermediate copy
+static const double minIntermediateDuration = 20;
+
+//Parts of the video sampled for static frames and their length
+static const int duplicateSamples = 3;
+static const double duplicateSampleLength = 5;
+
+//Seconds of the video used to measure the decoding, and how much faster the copy must be to be used
+static const double decodeBenchmarkLength = 3;
+static const double intermediateMargin = 1.2;
+
+//Parts copied as they are are cut at keyframes, they can be a bit bigger than planned
+static const double partSizeMargin = 0.9;
+
+//Shorter parts would be pointless, the size limit is just too small
+static const double minPartLength = 5;
+
+//Parts encoded at the same time when a video is split, each ffmpeg already uses several cores
+static const int partsInParallel = qBound(2, QThread::idealThreadCount() / 4, 4);
+
+//Live compression : length of the segments encoded while the video is recorded, time between two checks of the file,
+//number of checks without the file growing before the recording is considered done,
+//and seconds of video that must exist after a segment before it's encoded (the last frames are still being written)
+static const double liveSegmentLength = 20;
+static const int livePollIntervalMs = 2000;
+static const int liveClosedPolls = 3;
+static const double liveSafety = 2;
+
+//The concat of the segments adds a bit of container overhead
+static const double liveSizeMargin = 0.97;
+
+//Lossless and fast to write and read, only the size suffers
+static const QStringList intermediateArgs = { "-c:v", "libx264", "-qp", "0", "-preset", "ultrafast", "-an" };
+
+//Value of a field of a progress line of ffmpeg, ex : "time" => "00:00:05.12"
+//ffmpeg pads some values with spaces (fps=  60), they are skipped
+static QString progressField(const QString &line, const QString &key){
+    int index = line.indexOf(key + "=");
+    if (index < 0) return "";
+
+    int start = index + key.size() + 1;
+    while (start < line.size() && line.at(start) == ' ') start++;
+
+    int end = line.indexOf(' ', start);
+    return line.mid(start, end < 0 ? -1 : end - start);
+}
+
+CompressionEngine::CompressionEngine(QObject *parent)
+    : QObject(parent)
+{
+}
+
+void CompressionEngine::start(QList<VideoJob> jobs, QString ffmpeg, QString ffprobe, QDateTime deadline, long long unsigned sharedBits){
+    videoJobs = jobs;
+    totalVideosCompressing = jobs.count();
+    ffmpegPath = ffmpeg;
+    ffprobePath = ffprobe;
+    abortPressed = false;
+
+    batchBits = sharedBits;
+    batchJobs.clear();
+    batchSplit = false;
+
+    //The planner can lower the fps of a job until its pass 1, with a shared size limit every pass 1 is done first
+    planner.setDeadline(sharedBits > 0 ? QDateTime() : deadline);
+
+    //Also creates the cache path for the pass encoding files of ffmpeg
+    QDir().mkpath(QFileInfo(statsPrefix()).absolutePath());
+
+    JobLog::removeOldLogs(QStandardPaths::writableLocation(QStandardPaths::CacheLocation) + "/logs", keptLogFiles);
+
+    if (planner.isActive()){
+        job0ProbeQueue(0);
+        return;
+    }
+
+    job1StartLoop();
+}
+
+void CompressionEngine::abort(){
+    abortPressed = true;
+    videoJobs.clear();
+    batchJobs.clear();
+
+    if (liveTimer) liveTimer->stop();
+
+    stopProcesses();
+}
+
+//The planner needs the length and size of every video before the first one starts
+void CompressionEngine::job0ProbeQueue(int index){
+    if (index == 0){
+        openJobLog("queue");
+
+        emit stepChanged("Planning the queue", 0, EncoderBackend::byId(CurrentVJ().encoder)->passCount());
+    }
+
+    //MP4 and MOV files are read directly, ffprobe is only started for the other ones
+    while (index < videoJobs.count() && readMp4Info(videoJobs.at(index).inputPath, videoJobs[index].videoInfo)){
+        index++;
+    }
+
+    if (index >= videoJobs.count()){
+        job1StartLoop();
+        return;
+    }
+
+    runProcess(ffprobePath, ffprobeArgs(videoJobs.at(index).inputPath), [=](QProcess *ffprobe){
+        //The queue could have been aborted in the meantime
+        if (index >= videoJobs.count()) return;
+
+        readFfprobeOutput(ffprobe->readAllStandardOutput(), videoJobs[index].videoInfo);
+        job0ProbeQueue(index + 1);
+    });
+}
+
+// Starts or continue the loop of compression for all videos
+void CompressionEngine::job1StartLoop(){
+
+    //This function is called in a loop until no video is left
+    if (videoJobs.isEmpty()){
+
+        //Every job sharing the size limit is analysed, their pass 1 can start
+        if (!batchJobs.isEmpty()){
+            batch1Pass1();
+            return;
+        }
+
+        emit allFinished();
+        return;
+    }
+
+    job2GetVideoData();
+}
+
+//Starts by retrieving all video data using ffprobe, such as framerate, duration, width + height, etc
+void CompressionEngine::job2GetVideoData(){
+
+    //New log for this job, every pass of the job is written in the same file
+    openJobLog(QFileInfo(CurrentVJ().inputPath).completeBaseName());
+
+    emit jobStarted(totalVideosCompressing - videoJobs.count() + 1,
+                    totalVideosCompressing,
+                    QFileInfo(CurrentVJ().inputPath).fileName(),
+                    EncoderBackend::byId(CurrentVJ().encoder)->label());
+
+    //Shared size limit, the job is analysed and its pass 1 done with the others, only the pass 2 is left
+    if (batchSplit){
+        job3Pass2();
+        return;
+    }
+
+    //Already retrieved when planning the queue, or read directly from the boxes of an MP4 / MOV
+    if (CurrentVJ().videoInfo.duration > 0 || readMp4Info(CurrentVJ().inputPath, CurrentVJ().videoInfo)){
+        job2DetectCrop();
+        return;
+    }
+
+    emit stepChanged("Retrieving video data", 0, EncoderBackend::byId(CurrentVJ().encoder)->passCount());
+
+    //Sets up the ffprobe command and executes it
+    runProcess(ffprobePath, ffprobeArgs(CurrentVJ().inputPath), [=](QProcess *ffprobe){
+        //Gets the output of the command
+        readFfprobeOutput(ffprobe->readAllStandardOutput(), CurrentVJ().videoInfo);
+
+        //here we got the full videoInfo set, we look for black bars then start the job3 - Pass1
+        job2DetectCrop();
+    });
+}
+
+//Letterboxed or pillarboxed videos get their black bars cropped, every pass then encodes less pixels
+void CompressionEngine::job2DetectCrop(){
+    CurrentVJ().videoInfo.cropWidth = 0;
+
+    if (!CurrentVJ().detectCrop){
+        job2SampleDuplicates(0, 0, 0);
+        return;
+    }
+
+    emit stepChanged("Detecting black bars", 0, EncoderBackend::byId(CurrentVJ().encoder)->passCount());
+    currentPass = 0;
+
+    runProcess(ffmpegPath, cropDetectArgs(CurrentVJ()), [=](QProcess *ffmpeg){
+        //The crop lines are the last ones before the summary of ffmpeg
+        readCropDetectOutput(currentJobLog->tail(16, ffmpeg), CurrentVJ().videoInfo);
+        job2SampleDuplicates(0, 0, 0);
+    });
+}
+
+//Screen recordings can have long static parts, a few parts of the video are sampled with mpdecimate
+//to know how many frames would be dropped, keptFrames and totalFrames are the counts of the samples done
+void CompressionEngine::job2SampleDuplicates(int sample, double keptFrames, double totalFrames){
+    VideoJob &job = CurrentVJ();
+    double clipDuration = job.clipDuration();
+
+    if (sample == 0){
+        job.videoInfo.duplicateRatio = 0;
+
+        //The trim range error is handled by the pass 1
+        if (!job.decimate || clipDuration <= 0 || job.outputFps() <= 0){
+            job3Pass1();
+            return;
+        }
+
+        emit stepChanged("Looking for static frames", 0, EncoderBackend::byId(job.encoder)->passCount());
+        currentPass = 0;
+    }
+
+    if (sample >= duplicateSamples){
+        if (totalFrames > 0){
+            job.videoInfo.duplicateRatio = qBound(0.0, 1 - keptFrames / totalFrames, 1.0);
+        }
+        job3Pass1();
+        return;
+    }
+
+    //Parts evenly spread on the clip, ex : 1/6, 1/2 and 5/6 for 3 samples
+    double length = qMin(duplicateSampleLength, clipDuration / duplicateSamples);
+    double start = job.trimStart + clipDuration * (sample + 0.5) / duplicateSamples - length / 2;
+
+    runProcess(ffmpegPath, duplicateSampleArgs(job, start, length), [=](QProcess *ffmpeg){
+        //Frames left after mpdecimate, from the last stats line of ffmpeg
+        double kept = progressField(currentJobLog->lastProgressLine(ffmpeg), "frame").toDouble();
+        job2SampleDuplicates(sample + 1, keptFrames + kept, totalFrames + length * CurrentVJ().outputFps());
+    });
+}
+
+//Starts the Pass1 of the compression, after getting all of the video data
+//Pass 1 = Scanning the file and making a file with all of the data
+void CompressionEngine::job3Pass1(){
+    QString fileName = QFileInfo(CurrentVJ().inputPath).fileName();
+
+    //Making the Pass1
+    //Maths to get the final video bitrate + other stuff kms
+    if (CurrentVJ().clipDuration() <= 0){
+        fail("The trim range of " + fileName + " is outside of the video !");
+        return;
+    }
+
+    //The fps chosen by the planner is needed for the bitrate
+    replan(false);
+
+    //Shared size limit, the job waits for the others to be analysed, their pass 1 then run together
+    if (batchBits > 0){
+        batchJobs << videoJobs.takeFirst();
+        job1StartLoop();
+        return;
+    }
+
+    //Too long for the size limit, the video is split into parts each under the size limit
+    if (CurrentVJ().splitIntoParts
+        && CurrentVJ().videoBitrateFor(CurrentVJ().targetBits) < CurrentVJ().minimumVideoBitrateKbps()){
+        job4SplitIntoParts();
+        return;
+    }
+
+    if (!CurrentVJ().computeEncodingSettings()){
+        fail("The size limit is too small for " + fileName + " !");
+        return;
+    }
+
+    //Single pass encoders go straight to the encoding
+    const EncoderBackend *encoder = EncoderBackend::byId(CurrentVJ().encoder);
+    if (encoder->passCount() < 2){
+        job3Pass2();
+        return;
+    }
+
+    //Decides first if the pass 2 will read a copy made by the pass 1 instead of decoding the source again
+    job3MeasureDecoding([=](){
+        emit stepChanged("Pass 1", 1, encoder->passCount());
+        lastProgress = -1;
+        currentPass = 1;
+
+        //Sets up the ffmpeg command and executes it, the audio is not needed for the analysis
+        QStringList args;
+        args << "-y" << CurrentVJ().inputArgs()
+             << CurrentVJ().rateArgs()
+             << CurrentVJ().filterArgs()
+             << encoder->passArgs(1, CurrentVJ().videoInfo.videoBitrateKbps, currentStatsPrefix(), CurrentVJ().preset)
+             << encoder->threadArgs()
+             << "-an" << "-f" << "null" << "NUL";
+
+        //Second output of the same command, the frames are decoded, cropped and converted to the output fps only once
+        if (CurrentVJ().intermediatePath != ""){
+            args << "-map" << "0:v:0"
+                 << CurrentVJ().rateArgs()
+                 << CurrentVJ().filterArgs()
+                 << intermediateArgs
+                 << CurrentVJ().intermediatePath;
+        }
+
+        runProcess(ffmpegPath, args, [=](QProcess*){
+            job3Pass2();
+            //Pass2 !!
+        });
+    });
+}
+
+//Measures on a few seconds of the middle of the video the time to decode it, to write the lossless copy
+//and to read the copy, then uses the copy only if decoding the source again costs more than the copy itself
+//and if the scratch folder has enough space for it
+void CompressionEngine::job3MeasureDecoding(std::function<void()> onDecided){
+    CurrentVJ().intermediatePath = "";
+
+    double clipDuration = CurrentVJ().clipDuration();
+    if (clipDuration < minIntermediateDuration){
+        onDecided();
+        return;
+    }
+
+    emit stepChanged("Measuring the decoding", 0, EncoderBackend::byId(CurrentVJ().encoder)->passCount());
+    currentPass = 0;
+
+    QString folder = QFileInfo(statsPrefix()).absolutePath();
+    QString benchmarkFile = folder + "/decode_benchmark.mkv";
+    double start = CurrentVJ().trimStart + clipDuration / 2;
+
+    QStringList input = { "-y",
+                         "-ss", QString::number(start, 'f', 3),
+                         "-t", QString::number(decodeBenchmarkLength, 'f', 3),
+                         "-i", CurrentVJ().inputPath,
+                         "-map", "0:v:0" };
+    input << CurrentVJ().rateArgs() << CurrentVJ().filterArgs();
+
+    QStringList decodeArgs = QStringList() << input << "-f" << "null" << "NUL";
+    QStringList writeArgs = QStringList() << input << intermediateArgs << benchmarkFile;
+    QStringList readArgs = { "-y", "-i", benchmarkFile, "-map", "0:v:0", "-f", "null", "NUL" };
+
+    benchmarkTimer.start();
+
+    runProcess(ffmpegPath, decodeArgs, [=](QProcess*){
+        double decodeTime = benchmarkTimer.restart() / 1000.0;
+
+        runProcess(ffmpegPath, writeArgs, [=](QProcess*){
+            double writeTime = benchmarkTimer.restart() / 1000.0;
+            qint64 benchmarkSize = QFileInfo(benchmarkFile).size();
+
+            runProcess(ffmpegPath, readArgs, [=](QProcess*){
+                double readTime = benchmarkTimer.elapsed() / 1000.0;
+                QFile::remove(benchmarkFile);
+
+                //Writing the copy also decodes the source, only the difference is the cost of the writing
+                double copyTime = qMax(0.0, writeTime - decodeTime) + readTime;
+                bool worthIt = decodeTime > copyTime * intermediateMargin;
+
+                double expectedSize = benchmarkSize * clipDuration / decodeBenchmarkLength;
+                QStorageInfo storage(folder);
+                bool fits = storage.isValid() && storage.bytesAvailable() > expectedSize * intermediateMargin;
+
+                if (worthIt && fits && benchmarkSize > 0){
+                    CurrentVJ().intermediatePath = folder + "/intermediate.mkv";
+                }
+
+                currentJobLog->append(QString("Decode once : %1 (decode %2s, copy %3s, copy size %4 MB)\n")
+                                          .arg(CurrentVJ().intermediatePath != "" ? "yes" : "no")
+                                          .arg(decodeTime, 0, 'f', 2)
+                                          .arg(copyTime, 0, 'f', 2)
+                                          .arg(expectedSize / 1000000, 0, 'f', 0)
+                                          .toUtf8());
+
+                onDecided();
+            });
+        });
+    });
+}
+
+//job3 - Pass2 !!
+//Reencode the video with the calculated bitrate for the video, custom fps if any, and data from the
+//generated stats of the pass 1
+void CompressionEngine::job3Pass2(){
+    const EncoderBackend *encoder = EncoderBackend::byId(CurrentVJ().encoder);
+
+    //The pass 1 gave the real speed of this video, the jobs left are planned again with it
+    replan(true);
+
+    emit stepChanged(encoder->passCount() < 2 ? "Encoding" : "Pass 2", encoder->passCount(), encoder->passCount());
+    lastProgress = -1;
+    currentPass = encoder->passCount();
+
+    runCommands(lastPassArgs(CurrentVJ(), currentStatsPrefix()), [=](){
+
+        //Removes the stats of the passes, they're useless now
+        for (const QString &statsFile : encoder->statsFiles(currentStatsPrefix())){
+            QFile::remove(statsFile);
+        }
+
+        if (CurrentVJ().intermediatePath != ""){
+            QFile::remove(CurrentVJ().intermediatePath);
+        }
+
+        finishCurrentJob();
+    });
+}
+
+void CompressionEngine::finishCurrentJob(){
+    //Because the compression is done, removes the video from the "queue"
+    videoJobs.takeFirst();
+
+    //Restarts the loop
+    job1StartLoop();
+}
+
+//Number of parts needed to copy the video as it is, and to encode it with at least the minimum bitrate
+//The copy is only used if it doesn't need more parts than the encoding, the quality is then the one of the source
+void CompressionEngine::job4SplitIntoParts(){
+    //The parts can't share their passes with the other sizes, each size becomes a job of its own right after this one
+    //(split too if it needs it), its parts get the name of its own output
+    const QList<VideoTarget> sizes = CurrentVJ().extraTargets;
+    CurrentVJ().extraTargets.clear();
+
+    for (int i = 0; i < sizes.count(); i++){
+        VideoJob size = CurrentVJ();
+        size.targetBits = sizes.at(i).targetBits;
+        size.outputPath = sizes.at(i).outputPath;
+
+        videoJobs.insert(1 + i, size);
+        totalVideosCompressing++;
+    }
+
+    VideoJob &job = CurrentVJ();
+    double duration = job.clipDuration();
+
+    //Longest part getting the minimum video bitrate on top of the audio
+    double maxEncodedLength = job.targetBits / ((job.minimumVideoBitrateKbps() + job.videoInfo.audioBitrateKbps) * 1000.0);
+    if (maxEncodedLength < minPartLength){
+        fail("The size limit is too small for " + QFileInfo(job.inputPath).fileName() + ", even split into parts !");
+        return;
+    }
+
+    int encodedParts = qMax(2, qCeil(duration / maxEncodedLength));
+
+    if (job.videoInfo.sourceBitrateKbps > 0){
+        double sourceBits = job.videoInfo.sourceBitrateKbps * 1000.0 * duration;
+        int copiedParts = qMax(2, qCeil(sourceBits / (job.targetBits * partSizeMargin)));
+
+        if (copiedParts <= encodedParts){
+            job4CopyParts(copiedParts, encodedParts);
+            return;
+        }
+    }
+
+    job4EncodeParts(encodedParts);
+}
+
+//Cuts the video with the segment muxer without any encoding, ffmpeg cuts on the first keyframe after each split time
+//encodedParts is the number of parts needed if they have to be encoded after all
+void CompressionEngine::job4CopyParts(int partCount, int encodedParts){
+    QFileInfo output(CurrentVJ().outputPath);
+
+    //The streams are copied, the parts keep the container of the source
+    QString extension = QFileInfo(CurrentVJ().inputPath).suffix();
+    QString pattern = output.absolutePath() + "/" + output.completeBaseName() + "_part%d." + extension;
+
+    //Parts of an older compression of the same video would be counted with the new ones
+    for (int i = 1; QFileInfo::exists(QString(pattern).replace("%d", QString::number(i))); i++){
+        QFile::remove(QString(pattern).replace("%d", QString::number(i)));
+    }
+
+    emit stepChanged("Copying " + QString::number(partCount) + " parts", 1, 1);
+    lastProgress = -1;
+    currentPass = 0;
+
+    QStringList args;
+    args << "-y" << CurrentVJ().inputArgs()
+         << "-map" << "0:v:0" << "-map" << "0:a?"
+         << "-c" << "copy"
+         << "-f" << "segment"
+         << "-segment_time" << QString::number(CurrentVJ().clipDuration() / partCount, 'f', 3)
+         << "-segment_start_number" << "1"
+         << "-reset_timestamps" << "1"
+         << pattern;
+
+    runProcess(ffmpegPath, args, [=](QProcess*){
+
+        //The keyframes can make a part too big, the parts are then encoded instead, short enough for the minimum bitrate
+        bool fits = true;
+        QStringList partFiles;
+        for (int i = 1; QFileInfo::exists(QString(pattern).replace("%d", QString::number(i))); i++){
+            QString partFile = QString(pattern).replace("%d", QString::number(i));
+            partFiles << partFile;
+
+            if (static_cast<long long unsigned>(QFileInfo(partFile).size()) * 8 > CurrentVJ().targetBits){
+                fits = false;
+            }
+        }
+
+        if (!fits){
+            for (const QString &partFile : partFiles){
+                QFile::remove(partFile);
+            }
+            job4EncodeParts(qMax(encodedParts, partFiles.count()));
+            return;
+        }
+
+        finishCurrentJob();
+    });
+}
+
+//Each part is a job of its own, with its own two-pass budget and stats files, a few of them run at the same time
+void CompressionEngine::job4EncodeParts(int partCount){
+    const VideoJob &job = CurrentVJ();
+    QFileInfo output(job.outputPath);
+    double partLength = job.clipDuration() / partCount;
+
+    parts.clear();
+    for (int i = 0; i < partCount; i++){
+        VideoJob part = job;
+        part.trimStart = job.trimStart + i * partLength;
+        part.trimEnd = part.trimStart + partLength;
+        part.splitIntoParts = false;
+        part.extraTargets.clear();
+        part.intermediatePath = "";
+        part.outputPath = output.absolutePath() + "/" + output.completeBaseName()
+                          + "_part" + QString::number(i + 1) + "." + output.suffix();
+
+        if (!part.computeEncodingSettings()){
+            fail("The size limit is too small for " + QFileInfo(job.inputPath).fileName() + " !");
+            return;
+        }
+
+        parts << part;
+    }
+
+    emit stepChanged("Encoding " + QString::number(partCount) + " parts", 1, 1);
+    lastProgress = -1;
+    currentPass = 0;
+
+    partsProgress = QVector<double>(partCount, 0);
+    nextPart = 0;
+    partsLeft = partCount;
+
+    for (int i = 0; i < partsInParallel; i++){
+        startNextPart();
+    }
+}
+
+void CompressionEngine::startNextPart(){
+    //A part that can't start fails the queue right away, inside runProcess
+    if (videoJobs.isEmpty() || nextPart >= parts.count()) return;
+
+    runPartPass(nextPart++, 1, [=](){
+        partsLeft--;
+        if (partsLeft == 0){
+            finishCurrentJob();
+            return;
+        }
+
+        startNextPart();
+    });
+}
+
+void CompressionEngine::runPartPass(int index, int pass, std::function<void()> onDone){
+    const VideoJob &part = parts.at(index);
+    const EncoderBackend *encoder = EncoderBackend::byId(part.encoder);
+    QString prefix = statsPrefix() + "_part" + QString::number(index + 1);
+
+    QStringList args;
+    args << "-y" << part.inputArgs()
+         << part.rateArgs()
+         << part.filterArgs()
+         << encoder->passArgs(pass, part.videoInfo.videoBitrateKbps, prefix, part.preset)
+         << encoder->threadArgs();
+
+    if (pass < encoder->passCount()){
+        args << "-an" << "-f" << "null" << "NUL";
+    }else{
+        args << encoder->audioArgs(part.videoInfo.audioBitrateKbps) << part.outputPath;
+    }
+
+    //Progress of the whole video : the mean of the progress of every part
+    auto onTime = [=](double seconds){
+        double partProgress = qBound(0.0, seconds / parts.at(index).clipDuration(), 1.0);
+        partsProgress[index] = (pass - 1 + partProgress) / encoder->passCount();
+
+        double progress = 0;
+        for (double value : partsProgress) progress += value;
+        progress /= partsProgress.count();
+
+        if (progress - lastProgress < 0.001) return;
+        lastProgress = progress;
+        emit progressChanged(progress);
+    };
+
+    runProcess(ffmpegPath, args, [=](QProcess*){
+        if (pass < encoder->passCount()){
+            runPartPass(index, pass + 1, onDone);
+            return;
+        }
+
+        for (const QString &statsFile : encoder->statsFiles(prefix)){
+            QFile::remove(statsFile);
+        }
+
+        onDone();
+    }, onTime);
+}
+
+//Shared size limit : the pass 1 of every job runs first, a few at a time like the parts of a split video,
+//the bits are split once the complexity of every video is known
+void CompressionEngine::batch1Pass1(){
+    videoJobs = batchJobs;
+    batchJobs.clear();
+    totalVideosCompressing = videoJobs.count();
+
+    openJobLog("batch");
+    emit jobStarted(1, 1, QString::number(videoJobs.count()) + " videos", EncoderBackend::byId(CurrentVJ().encoder)->label());
+
+    //Bitrate of the pass 1 until the complexity is known, the stats are brought back to a common quantizer anyway
+    if (!splitSizeLimit(videoJobs, pixelWeights(videoJobs), batchBits)){
+        fail("The size limit is too small for the whole list, not even the audio fits !");
+        return;
+    }
+
+    batchProgress = QVector<double>(videoJobs.count(), 1);
+    batchNext = 0;
+    batchLeft = 0;
+
+    for (int i = 0; i < videoJobs.count(); i++){
+        VideoJob &job = videoJobs[i];
+        job.statsPrefix = statsPrefix() + "_batch" + QString::number(i + 1);
+
+        if (!job.computeEncodingSettings()){
+            fail("The size limit is too small for " + QFileInfo(job.inputPath).fileName() + " !");
+            return;
+        }
+
+        //Single pass encoders have nothing to do yet
+        if (EncoderBackend::byId(job.encoder)->passCount() >= 2){
+            batchProgress[i] = 0;
+            batchLeft++;
+        }
+    }
+
+    if (batchLeft == 0){
+        batch2SplitSize();
+        return;
+    }
+
+    emit stepChanged("Pass 1 of every video", 1, 2);
+    lastProgress = -1;
+    currentPass = 1;
+
+    for (int i = 0; i < partsInParallel; i++){
+        batchStartNext();
+    }
+}
+
+void CompressionEngine::batchStartNext(){
+    //Same as the parts, the queue may have failed while starting the previous one
+    if (videoJobs.isEmpty()) return;
+
+    while (batchNext < videoJobs.count()
+           && EncoderBackend::byId(videoJobs.at(batchNext).encoder)->passCount() < 2){
+        batchNext++;
+    }
+
+    if (batchNext >= videoJobs.count()) return;
+
+    int index = batchNext++;
+    const VideoJob &job = videoJobs.at(index);
+    const EncoderBackend *encoder = EncoderBackend::byId(job.encoder);
+
+    QStringList args;
+    args << "-y" << job.inputArgs()
+         << job.rateArgs()
+         << job.filterArgs()
+         << encoder->passArgs(1, job.videoInfo.videoBitrateKbps, job.statsPrefix, job.preset)
+         << encoder->threadArgs()
+         << "-an" << "-f" << "null" << "NUL";
+
+    //Progress of the whole queue : the mean of the progress of every video
+    auto onTime = [=](double seconds){
+        if (index >= videoJobs.count()) return;
+
+        batchProgress[index] = qBound(0.0, seconds / videoJobs.at(index).clipDuration(), 1.0);
+
+        double progress = 0;
+        for (double value : batchProgress) progress += value;
+        progress /= batchProgress.count();
+
+        if (progress - lastProgress < 0.001) return;
+        lastProgress = progress;
+        emit progressChanged(progress);
+    };
+
+    //Every video of the list writes in the same log, the error must tell which one failed
+    //(read before starting, a process that can't start clears the jobs right away)
+    QString fileName = QFileInfo(job.inputPath).fileName();
+
+    QProcess *ffmpeg = runProcess(ffmpegPath, args, [=](QProcess*){
+        batchLeft--;
+        if (batchLeft == 0){
+            batch2SplitSize();
+            return;
+        }
+
+        batchStartNext();
+    }, onTime);
+    ffmpeg->setObjectName(fileName);
+}
+
+//The bits go to the videos by complexity, read from the stats of the pass 1 when every encoder can tell it,
+//otherwise from the pixels to encode, then the pass 2 of every job runs one after the other
+void CompressionEngine::batch2SplitSize(){
+    bool fromStats = false;
+    QVector<double> weights = sizeWeights(videoJobs, &fromStats);
+
+    if (!splitSizeLimit(videoJobs, weights, batchBits)){
+        fail("The size limit is too small for the whole list, not even the audio fits !");
+        return;
+    }
+
+    currentJobLog->append(QString("Size split by %1\n").arg(fromStats ? "complexity" : "pixels").toUtf8());
+
+    for (VideoJob &job : videoJobs){
+        if (!job.computeEncodingSettings()){
+            fail("The size limit is too small for " + QFileInfo(job.inputPath).fileName() + " !");
+            return;
+        }
+
+        currentJobLog->append(QString("%1 : %2 MB, %3 kbps\n")
+                                  .arg(QFileInfo(job.inputPath).fileName())
+                                  .arg(job.targetBits / 8000000.0, 0, 'f', 2)
+                                  .arg(job.videoInfo.videoBitrateKbps)
+                                  .toUtf8());
+    }
+
+    batchSplit = true;
+    job1StartLoop();
+}
+
+//Compresses a video while it's still being recorded : segments are encoded as soon as they are written,
+//with the bitrate the expected length of the recording would give, then once the file stops growing
+//the end of the video gets whatever is left of the size limit and the segments are joined without encoding
+void CompressionEngine::startLive(VideoJob job, QString ffmpeg, QString ffprobe, double expectedDuration){
+    videoJobs = { job };
+    totalVideosCompressing = 1;
+    ffmpegPath = ffmpeg;
+    ffprobePath = ffprobe;
+    abortPressed = false;
+    planner.setDeadline(QDateTime());
+
+    batchBits = 0;
+    batchJobs.clear();
+    batchSplit = false;
+
+    QDir().mkpath(liveFolder());
+    openJobLog(QFileInfo(job.inputPath).completeBaseName() + "_live");
+
+    emit jobStarted(1, 1, QFileInfo(job.inputPath).fileName(), EncoderBackend::byId(job.encoder)->label());
+    emit stepChanged("Waiting for the recording", 0, 1);
+
+    parts.clear();
+    partsProgress.clear();
+    liveRecorded = 0;
+    liveLastSize = -1;
+    liveStablePolls = 0;
+    liveBusy = false;
+
+    //The size, fps and audio of the video are known from the start, only the duration is missing
+    runProcess(ffprobePath, ffprobeArgs(job.inputPath), [=](QProcess *ffprobe){
+        VideoJob &liveJob = CurrentVJ();
+        readFfprobeOutput(ffprobe->readAllStandardOutput(), liveJob.videoInfo);
+
+        //Provisional budget : the bitrate the whole recording would get if it lasts as expected
+        liveJob.trimStart = 0;
+        liveJob.trimEnd = 0;
+        liveJob.videoInfo.duration = expectedDuration;
+        if (!liveJob.computeEncodingSettings()){
+            fail("The size limit is too small for the expected length of the recording !");
+            return;
+        }
+
+        if (!liveTimer){
+            liveTimer = new QTimer(this);
+            connect(liveTimer, &QTimer::timeout, this, &CompressionEngine::livePoll);
+        }
+        liveTimer->start(livePollIntervalMs);
+    });
+}
+
+//Checks how much of the video is written, encodes the next segment if it's complete or the end once the recording is done
+void CompressionEngine::livePoll(){
+    if (videoJobs.isEmpty()){
+        liveTimer->stop();
+        return;
+    }
+
+    //Still encoding a segment or reading the file
+    if (liveBusy) return;
+
+    //The recording is done when the file stops growing for a few checks
+    qint64 size = QFileInfo(CurrentVJ().inputPath).size();
+    liveStablePolls = (size == liveLastSize ? liveStablePolls + 1 : 0);
+    liveLastSize = size;
+
+    //Time of the last packet written, only the packets after the last known time are read
+    QStringList args = {
+        "-v", "error",
+        "-select_streams", "v:0",
+        "-show_entries", "packet=pts_time",
+        "-of", "csv=p=0",
+        "-read_intervals", QString::number(qMax(0.0, liveRecorded - liveSafety), 'f', 3) + "%",
+        CurrentVJ().inputPath
+    };
+
+    liveBusy = true;
+    runProcess(ffprobePath, args, [=](QProcess *ffprobe){
+        const QList<QByteArray> lines = ffprobe->readAllStandardOutput().split('\n');
+        for (const QByteArray &line : lines){
+            bool ok = false;
+            double time = line.trimmed().toDouble(&ok);
+            if (ok && time > liveRecorded) liveRecorded = time;
+        }
+
+        emit stepChanged("Live, " + formatTimestamp(liveRecorded) + " recorded", 1, 1);
+
+        double segmentEnd = (parts.count() + 1) * liveSegmentLength;
+
+        if (liveStablePolls >= liveClosedPolls){
+            liveTimer->stop();
+            liveFinishTail();
+        }else if (liveRecorded >= segmentEnd + liveSafety){
+            liveEncodeSegment(parts.count() * liveSegmentLength, segmentEnd, CurrentVJ().videoInfo.videoBitrateKbps);
+        }else{
+            liveBusy = false;
+        }
+    });
+}
+
+//Encodes a part of the recording as a new segment, with its own two passes
+void CompressionEngine::liveEncodeSegment(double start, double end, int videoBitrateKbps, std::function<void()> onDone){
+    VideoJob segment = CurrentVJ();
+    segment.trimStart = start;
+    segment.trimEnd = end;
+    segment.videoInfo.duration = end;
+    segment.videoInfo.videoBitrateKbps = videoBitrateKbps;
+    segment.videoInfo.fps = segment.outputFps();
+    segment.extraTargets.clear();
+    segment.outputPath = liveFolder() + "/segment" + QString::number(parts.count() + 1)
+                         + "." + EncoderBackend::byId(segment.encoder)->containerExtension();
+
+    parts << segment;
+    partsProgress.resize(parts.count());
+    liveBusy = true;
+
+    runPartPass(parts.count() - 1, 1, [=](){
+        liveBusy = false;
+        if (onDone) onDone();
+    });
+}
+
+//The recording is done : the end gets what's left of the size limit
+//If the recording was a lot longer than expected, the last segments are encoded again with the end
+//so that the bitrate of the end doesn't drop under the minimum
+void CompressionEngine::liveFinishTail(){
+    VideoJob &job = CurrentVJ();
+    double end = liveRecorded + 1 / qMax(1.0, job.videoInfo.fps);
+    double budget = job.targetBits * liveSizeMargin;
+
+    double spentBits = 0;
+    for (const VideoJob &segment : parts){
+        spentBits += QFileInfo(segment.outputPath).size() * 8.0;
+    }
+
+    int videoBitrateKbps = 0;
+    double tailStart = parts.count() * liveSegmentLength;
+
+    while (true){
+        double tailLength = end - tailStart;
+        double tailBits = budget - spentBits - job.videoInfo.audioBitrateKbps * 1000.0 * tailLength;
+        videoBitrateKbps = (tailLength > 0 ? tailBits / tailLength / 1000 : 0);
+
+        if (videoBitrateKbps >= job.minimumVideoBitrateKbps() || parts.isEmpty()) break;
+
+        //The last segment goes back into the end
+        spentBits -= QFileInfo(parts.last().outputPath).size() * 8.0;
+        QFile::remove(parts.last().outputPath);
+        parts.removeLast();
+        tailStart -= liveSegmentLength;
+    }
+
+    partsProgress.resize(parts.count());
+
+    //Ended right at the end of a segment
+    if (end - tailStart < 0.1){
+        liveJoinSegments();
+        return;
+    }
+
+    if (videoBitrateKbps <= 0){
+        fail("The recording is too long for the size limit !");
+        return;
+    }
+
+    emit stepChanged("Live, encoding the end", 1, 1);
+    liveEncodeSegment(tailStart, end, videoBitrateKbps, [=](){
+        liveJoinSegments();
+    });
+}
+
+//Joins the segments with the concat demuxer, the streams are copied
+void CompressionEngine::liveJoinSegments(){
+    QString listPath = liveFolder() + "/segments.txt";
+    QFile list(listPath);
+    if (!list.open(QIODevice::WriteOnly | QIODevice::Truncate | QIODevice::Text)){
+        fail("Couldn't write the list of the segments !");
+        return;
+    }
+
+    QTextStream stream(&list);
+    for (const VideoJob &segment : parts){
+        //Quotes are escaped the way the concat demuxer expects
+        stream << "file '" << QString(segment.outputPath).replace("'", "'\\''") << "'\n";
+    }
+    list.close();
+
+    emit stepChanged("Live, joining the segments", 1, 1);
+
+    QStringList args = { "-y", "-f", "concat", "-safe", "0", "-i", listPath, "-c", "copy", CurrentVJ().outputPath };
+
+    runProcess(ffmpegPath, args, [=](QProcess*){
+        for (const VideoJob &segment : parts){
+            QFile::remove(segment.outputPath);
+        }
+        QFile::remove(listPath);
+
+        finishCurrentJob();
+    });
+}
+
+QString CompressionEngine::liveFolder(){
+    return QStandardPaths::writableLocation(QStandardPaths::CacheLocation) + "/live";
+}
+
+//New log file for a job, every command of the job is written in the same file
+void CompressionEngine::openJobLog(const QString &name){
+    delete currentJobLog;
+    currentJobLog = new JobLog(
+        QStandardPaths::writableLocation(QStandardPaths::CacheLocation) + "/logs/" + name
+            + "_" + QDateTime::currentDateTime().toString("yyyyMMdd-hhmmss") + ".log",
+        64,
+        this);
+}
+
+void CompressionEngine::replan(bool currentPass1Done){
+    if (!planner.isActive() || videoJobs.isEmpty()) return;
+
+    double secondsLeft = planner.plan(videoJobs, currentPass1Done);
+    QDateTime end = QDateTime::currentDateTime().addMSecs(secondsLeft * 1000);
+
+    QString plan = (CurrentVJ().preset != "" ? CurrentVJ().preset : "usual") + " preset";
+    if (CurrentVJ().plannedFpsLimit > 0){
+        plan += ", " + QString::number(CurrentVJ().plannedFpsLimit) + " fps";
+    }
+
+    plan += ", done around " + end.toString("hh:mm");
+    if (end > planner.deadline()){
+        plan += " (late by " + formatTimestamp(planner.deadline().msecsTo(end) / 1000.0) + ")";
+    }
+
+    emit planChanged(plan);
+}
+
+//To get the current VideoJob
+VideoJob& CompressionEngine::CurrentVJ(){
+    return videoJobs[0];
+}
+
+//Path without extension of the stats files written by the passes, in the cache folder of cutie
+QString CompressionEngine::statsPrefix(){
+    return QStandardPaths::writableLocation(QStandardPaths::CacheLocation) + "/tempffmpeg/ffmpeg_pass";
+}
+
+QString CompressionEngine::currentStatsPrefix(){
+    return CurrentVJ().statsPrefix != "" ? CurrentVJ().statsPrefix : statsPrefix();
+}
+
+void CompressionEngine::runCommands(QList<QStringList> commands, std::function<void()> onDone){
+    if (commands.isEmpty()){
+        onDone();
+        return;
+    }
+
+    QStringList args = commands.takeFirst();
+    lastProgress = -1;
+
+    runProcess(ffmpegPath, args, [=](QProcess*){
+        runCommands(commands, onDone);
+    });
+}
+
+QProcess* CompressionEngine::runProcess(const QString &program, const QStringList &args, std::function<void(QProcess*)> onSuccess,
+                                         std::function<void(double)> onTime){
+    QProcess *process = new QProcess(this);
+    runningProcesses.insert(process);
+
+    //Some encoders use a relative path for their stats file, so ffmpeg runs from the stats folder
+    process->setWorkingDirectory(QFileInfo(statsPrefix()).absolutePath());
+
+    //Called every time ffmpeg sends an update, can be a lot of times per second
+    //Parts encoded in parallel write in the same log, each process has its own lines and progress there
+    connect(process, &QProcess::readyReadStandardError, this, [=](){
+        currentJobLog->append(process->readAllStandardError(), process);
+
+        if (onTime){
+            double seconds = parseTimestamp(progressField(currentJobLog->lastProgressLine(process), "time"));
+            if (seconds > 0) onTime(seconds);
+        }else{
+            readProgress(currentJobLog->lastProgressLine(process));
+        }
+    });
+
+    connect(process, &QProcess::finished, this, [=](int exitCode, QProcess::ExitStatus status){
+        runningProcesses.remove(process);
+        process->deleteLater();
+
+        //onSuccess can open the log of the next job
+        QPointer<JobLog> log = currentJobLog;
+
+        //Killed by abort(), or by fail() when another process of the job failed
+        if (abortPressed || videoJobs.isEmpty()){
+            log->closeSource(process);
+            return;
+        }
+
+        log->append(process->readAllStandardError(), process);
+
+        if (exitCode != 0 || status != QProcess::NormalExit) {
+            qWarning() << "Error" << program << exitCode;
+            QString report = errorReport(QFileInfo(program).baseName().toUpper(), exitCode, process);
+            log->closeSource(process);
+            fail(report);
+            return;
+        }
+
+        onSuccess(process);
+        if (log) log->closeSource(process);
+    });
+
+    connect(process, &QProcess::errorOccurred, this, [=](QProcess::ProcessError error){
+        if (error != QProcess::FailedToStart || abortPressed) return;
+
+        runningProcesses.remove(process);
+        process->deleteLater();
+        currentJobLog->closeSource(process);
+        fail("Couldn't start " + program + " !");
+    });
+
+    currentJobLog->appendCommand(program, args);
+    process->start(program, args);
+
+    return process;
+}
+
+//ex : frame=  123 fps= 60 q=28.0 size=    1024kB time=00:00:05.12 bitrate=1638.4kbits/s speed=1.00x
+void CompressionEngine::readProgress(const QString &progressLine){
+    if (videoJobs.isEmpty()) return;
+
+    //Real speed of the encoder, ex : "1.25x", for the planning of the jobs left
+    QString speed = progressField(progressLine, "speed");
+    if (planner.isActive() && currentPass > 0 && speed.endsWith('x')){
+        planner.addSpeedSample(CurrentVJ(), currentPass, speed.chopped(1).toDouble());
+    }
+
+    //Negative or missing at the start of the encoding
+    double seconds = parseTimestamp(progressField(progressLine, "time"));
+    double duration = CurrentVJ().clipDuration();
+    if (seconds <= 0 || duration <= 0) return;
+
+    double progress = qBound(0.0, seconds / duration, 1.0);
+
+    //No need to send anything if it barely moved
+    if (progress - lastProgress < 0.001) return;
+
+    lastProgress = progress;
+    emit progressChanged(progress);
+}
+
+QString CompressionEngine::errorReport(const QString &processName, int exitCode, const QProcess *process){
+    QString report = "Error " + processName + " : " + QString::number(exitCode);
+
+    //Name of the video given to the process when several videos share the log
+    if (process && process->objectName() != ""){
+        report = "Error " + processName + " (" + process->objectName() + ") : " + QString::number(exitCode);
+    }
+
+    if (currentJobLog){
+        report += "\n" + currentJobLog->tail(errorTailLines, process).join("\n")
+                  + "\nFull log : " + currentJobLog->filePath();
+    }
+
+    return report;
+}
+
+void CompressionEngine::fail(const QString &error){
+    videoJobs.clear();
+    batchJobs.clear();
+
+    //Nothing left to start for the parts or the pass 1 of the list
+    parts.clear();
+    nextPart = 0;
+    partsLeft = 0;
+    batchNext = 0;
+    batchLeft = 0;
+
+    if (liveTimer) liveTimer->stop();
+
+    //Other parts of the same video could still be running
+    stopProcesses();
+
+    emit jobFailed(error);
+}
+
+void CompressionEngine::stopProcesses(){
+    const QSet<QProcess*> processes = runningProcesses;
+    runningProcesses.clear();
+
+    for (QProcess *process : processes){
+        //They end a bit later, maybe once the next queue started : their end must not be taken for one of its processes
+        disconnect(process, nullptr, this, nullptr);
+        connect(process, &QProcess::finished, process, &QObject::deleteLater);
+        process->kill();
+    }
+}
+
+QList<QStringList> lastPassArgs(const VideoJob &job, const QString &statsPrefix){
+    const EncoderBackend *encoder = EncoderBackend::byId(job.encoder);
+
+    //Generates the ffmpeg args with the data
+    //it took way too much times to do and debug, worst thing ever 10/10
+    QStringList inputs;
+    QStringList maps;
+    QStringList filters;
+
+    //The video comes from the copy made by the pass 1 (already cropped), only the audio is still read from the source
+    if (job.intermediatePath != ""){
+        inputs << "-i" << job.intermediatePath << job.inputArgs();
+        maps << "-map" << "0:v:0" << "-map" << "1:a:0?";
+    }else{
+        inputs << job.inputArgs();
+        filters = job.filterArgs();
+    }
+
+    auto output = [&](int videoBitrateKbps, const QString &outputPath){
+        return QStringList()
+               << maps
+               << job.rateArgs()
+               << filters
+               << encoder->passArgs(encoder->passCount(), videoBitrateKbps, statsPrefix, job.preset)
+               << encoder->threadArgs()
+               << encoder->audioArgs(job.videoInfo.audioBitrateKbps)
+               << outputPath;
+    };
+
+    QList<QStringList> commands = { QStringList() << "-y" << inputs << output(job.videoInfo.videoBitrateKbps, job.outputPath) };
+
+    //The frames are decoded once and given to every encoder when each output can find the stats of the pass 1
+    bool sharedPass = encoder->passCount() < 2 || encoder->namedStats();
+
+    for (const VideoTarget &target : job.extraTargets){
+        if (sharedPass){
+            commands.first() << output(target.videoBitrateKbps, target.outputPath);
+        }else{
+            commands << (QStringList() << "-y" << inputs << output(target.videoBitrateKbps, target.outputPath));
+        }
+    }
+
+    return commands;
+}
+
+QVector<double> sizeWeights(const QList<VideoJob> &jobs, bool *fromStats){
+    QVector<double> weights;
+    bool complete = true;
+
+    for (const VideoJob &job : jobs){
+        double complexity = EncoderBackend::byId(job.encoder)->statsComplexity(job.statsPrefix);
+        if (complexity <= 0) complete = false;
+        weights << complexity;
+    }
+
+    //A missing complexity can't be guessed from the others, every job is then weighed by its pixels
+    if (!complete) weights = pixelWeights(jobs);
+
+    if (fromStats) *fromStats = complete;
+    return weights;
+}
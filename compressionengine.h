@@ -0,0 +1,181 @@
+#ifndef COMPRESSIONENGINE_H
+#define COMPRESSIONENGINE_H
+
+#include <QObject>
+#include <QProcess>
+#include <QSet>
+#include <QElapsedTimer>
+#include <QVector>
+#include <functional>
+#include "videojob.h"
+#include "deadlineplanner.h"
+
+class JobLog;
+class QTimer;
+
+//Runs the compression of the videos (ffprobe, pass 1, pass 2...) in its own thread
+//The ui only receives the signals and displays them at its own pace, so that the ffmpeg outputs
+//never slow down the ui, however many updates ffmpeg sends
+class CompressionEngine : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit CompressionEngine(QObject *parent = nullptr);
+
+public slots:
+    //Compresses every job, one after the other
+    //With a valid deadline, the presets and fps of the jobs are planned so that the queue is done in time
+    //With sharedBits, the size limit is for the whole queue : the pass 1 of every job is done first
+    //and the bits go where the videos need them (the deadline is then not used)
+    void start(QList<VideoJob> jobs, QString ffmpeg, QString ffprobe, QDateTime deadline, long long unsigned sharedBits = 0);
+
+    //Compresses a video while it's still being recorded, expectedDuration gives the bitrate until the recording is done
+    void startLive(VideoJob job, QString ffmpeg, QString ffprobe, double expectedDuration);
+
+    //Stops the current processes and forgets every job left
+    void abort();
+
+signals:
+    //fileIndex starts at 1
+    void jobStarted(int fileIndex, int fileCount, QString fileName, QString encoder);
+
+    //pass is 0 while retrieving the video data
+    void stepChanged(QString step, int pass, int passCount);
+
+    //Progress of the current pass, from 0 to 1
+    void progressChanged(double passProgress);
+
+    //Settings chosen by the deadline planner for the current job and when the queue should be done
+    void planChanged(QString plan);
+
+    //The compression stops after a failed job
+    void jobFailed(QString error);
+
+    void allFinished();
+
+private:
+    //Retrieves the video data of every job before planning them, index is the job being probed
+    void job0ProbeQueue(int index);
+
+    void job1StartLoop();
+    void job2GetVideoData();
+    void job2DetectCrop();
+    void job2SampleDuplicates(int sample, double keptFrames, double totalFrames);
+    void job3Pass1();
+
+    //Chooses if the pass 1 also writes a lossless copy of the clip for the pass 2, then calls onDecided
+    void job3MeasureDecoding(std::function<void()> onDecided);
+    void job3Pass2();
+
+    //Splits the current video into parts under the size limit, copied as they are if they already fit, encoded otherwise
+    //Its other sizes are queued as jobs of their own
+    void job4SplitIntoParts();
+    void job4CopyParts(int partCount, int encodedParts);
+    void job4EncodeParts(int partCount);
+    void startNextPart();
+
+    //Runs the given pass of a part then the next ones, onDone is called after the last one
+    void runPartPass(int index, int pass, std::function<void()> onDone);
+
+    //Shared size limit : once every job is analysed, runs their pass 1 a few at a time then splits the bits
+    void batch1Pass1();
+    void batchStartNext();
+    void batch2SplitSize();
+
+    void livePoll();
+    void liveEncodeSegment(double start, double end, int videoBitrateKbps, std::function<void()> onDone = nullptr);
+    void liveFinishTail();
+    void liveJoinSegments();
+    QString liveFolder();
+
+    void openJobLog(const QString &name);
+
+    //Called once every part of the current video is done
+    void finishCurrentJob();
+
+    //Plans again the jobs left with the speed measured so far
+    void replan(bool currentPass1Done);
+
+    VideoJob& CurrentVJ();
+    QString statsPrefix();
+
+    //Stats files of the passes of the current job
+    QString currentStatsPrefix();
+
+    //Runs the ffmpeg commands one after the other, onDone is called once the last one succeeded
+    void runCommands(QList<QStringList> commands, std::function<void()> onDone);
+
+    //Starts a process for the current job, its output goes into the log of the job and its progress to the ui
+    //onSuccess is only called if the process exits without any error
+    //With onTime, the time reached by ffmpeg is given to it instead of being sent as the progress of the current pass
+    QProcess* runProcess(const QString &program, const QStringList &args, std::function<void(QProcess*)> onSuccess,
+                         std::function<void(double)> onTime = nullptr);
+
+    //Reads the time of a progress line of ffmpeg and sends the progress of the current pass
+    void readProgress(const QString &progressLine);
+
+    //Builds the message shown when ffmpeg or ffprobe fails, with the last lines it wrote in the log
+    QString errorReport(const QString &processName, int exitCode, const QProcess *process);
+
+    void fail(const QString &error);
+
+    //Kills every running process, without handling their end
+    void stopProcesses();
+
+    //Stores all of the jobs left to do, the first one is the current one
+    QList<VideoJob> videoJobs;
+    int totalVideosCompressing = 0;
+
+    QString ffmpegPath;
+    QString ffprobePath;
+
+    //Log of the current job, keeps the last lines of every ffmpeg and streams everything to a file
+    JobLog *currentJobLog = nullptr;
+
+    QSet<QProcess*> runningProcesses;
+    bool abortPressed = false;
+
+    //Last progress sent, to avoid sending the same value again
+    double lastProgress = -1;
+
+    //Pass of the current job being encoded, to know what the speed of ffmpeg is about
+    int currentPass = 0;
+
+    DeadlinePlanner planner;
+
+    //Times the commands measuring the decoding
+    QElapsedTimer benchmarkTimer;
+
+    //Parts of the current video when it's split and encoded, a few at a time
+    QList<VideoJob> parts;
+    QVector<double> partsProgress;
+    int nextPart = 0;
+    int partsLeft = 0;
+
+    //Size limit shared by the whole queue (0 = each job has its own), the jobs analysed and waiting for the others,
+    //and if the bits are split and only the pass 2 of every job is left
+    long long unsigned batchBits = 0;
+    QList<VideoJob> batchJobs;
+    bool batchSplit = false;
+    QVector<double> batchProgress;
+    int batchNext = 0;
+    int batchLeft = 0;
+
+    //Live compression, the segments already encoded are in parts
+    QTimer *liveTimer = nullptr;
+    double liveRecorded = 0;
+    qint64 liveLastSize = -1;
+    int liveStablePolls = 0;
+    bool liveBusy = false;
+};
+
+//ffmpeg commands of the last pass of a job, the main output and every extra size, with the stats of its pass 1
+//One command with an output per size when the encoder can share its stats between outputs, one command per size otherwise
+QList<QStringList> lastPassArgs(const VideoJob &job, const QString &statsPrefix);
+
+//Weights splitting a shared size limit once every pass 1 is done : the complexity read from the stats of each job,
+//or the pixels of every job if one of the encoders can't tell it (fromStats is then false)
+QVector<double> sizeWeights(const QList<VideoJob> &jobs, bool *fromStats = nullptr);
+
+#endif // COMPRESSIONENGINE_H
@@ -0,0 +1,160 @@
+#include "deadlineplanner.h"
+#include "encoderbackend.h"
+#include <QThread>
+#include <QVector>
+
+//First guess of the speed of x264 medium for each core, a bit pessimistic on purpose
+static const double defaultPixelsPerSecondPerCore = 10000000;
+
+//fps limits tried one after the other when even the fastest presets can't make it
+static const QList<int> fpsCaps = { 30, 24 };
+
+void DeadlinePlanner::setDeadline(const QDateTime &deadline){
+    deadlineTime = deadline;
+}
+
+QDateTime DeadlinePlanner::deadline() const{
+    return deadlineTime;
+}
+
+bool DeadlinePlanner::isActive() const{
+    return deadlineTime.isValid();
+}
+
+double DeadlinePlanner::jobCost(const VideoJob &job, const QString &preset, int plannedFpsLimit, bool withPass1) const{
+    const EncoderBackend *encoder = EncoderBackend::byId(job.encoder);
+
+    VideoJob planned = job;
+    planned.plannedFpsLimit = plannedFpsLimit;
+    double pixels = planned.clipDuration() * planned.effectiveFps() * planned.outputWidth() * planned.outputHeight();
+
+    //Every target is encoded by the last pass
+    double cost = encoder->relativeCost(encoder->passCount(), preset) * (1 + planned.extraTargets.count());
+    if (withPass1 && encoder->passCount() >= 2){
+        cost += encoder->relativeCost(1, preset);
+    }
+
+    return pixels * cost / pixelsPerSecond;
+}
+
+double DeadlinePlanner::plan(QList<VideoJob> &jobs, bool currentPass1Done){
+    if (!isActive()) return 0;
+
+    if (pixelsPerSecond <= 0){
+        pixelsPerSecond = defaultPixelsPerSecondPerCore * QThread::idealThreadCount();
+    }
+
+    double secondsLeft = QDateTime::currentDateTime().msecsTo(deadlineTime) / 1000.0;
+    int count = jobs.count();
+
+    //For each job : the presets of its encoder, the index of the chosen one (0 = the fastest) and its fps limit
+    QVector<QStringList> presets(count);
+    QVector<int> levels(count, 0);
+    QVector<int> fpsLimits(count, 0);
+
+    for (int i = 0; i < count; i++){
+        presets[i] = EncoderBackend::byId(jobs.at(i).encoder)->presets();
+    }
+
+    //The fps and preset of the current job can't change anymore, the pass 2 must use the settings of the pass 1
+    bool fpsFixed = (count > 0 && currentPass1Done);
+    if (fpsFixed){
+        fpsLimits[0] = jobs.at(0).plannedFpsLimit;
+        levels[0] = qMax(0, presets.at(0).indexOf(jobs.at(0).preset));
+    }
+
+    auto presetOf = [&](int i, int level){
+        return presets.at(i).isEmpty() ? QString() : presets.at(i).at(level);
+    };
+
+    auto cost = [&](int i, int level, int fpsLimit){
+        return jobCost(jobs.at(i), presetOf(i, level), fpsLimit, !(i == 0 && currentPass1Done));
+    };
+
+    auto outputFps = [&](int i, int fpsLimit){
+        VideoJob planned = jobs.at(i);
+        planned.plannedFpsLimit = fpsLimit;
+        return planned.outputFps();
+    };
+
+    //Everything at the fastest preset first (except the current job if its pass 1 is done)
+    double total = 0;
+    for (int i = 0; i < count; i++){
+        total += cost(i, levels.at(i), fpsLimits.at(i));
+    }
+
+    //Still too long, the fps of the job saving the most time is lowered until it fits
+    while (total > secondsLeft){
+        int best = -1;
+        int bestCap = 0;
+        double bestSaving = 0;
+
+        for (int i = (fpsFixed ? 1 : 0); i < count; i++){
+            double fps = outputFps(i, fpsLimits.at(i));
+
+            //Next cap under the current fps, 29.97 fps is not capped to 30
+            for (int cap : fpsCaps){
+                if (cap >= fps - 0.5) continue;
+
+                double saving = cost(i, 0, fpsLimits.at(i)) - cost(i, 0, cap);
+                if (saving > bestSaving){
+                    best = i;
+                    bestCap = cap;
+                    bestSaving = saving;
+                }
+                break;
+            }
+        }
+
+        //Nothing left to lower, the queue will be late anyway
+        if (best < 0) break;
+
+        fpsLimits[best] = bestCap;
+        total -= bestSaving;
+    }
+
+    //Then the time left goes into better presets, one step at a time for the job with the worst preset,
+    //so that every video ends up with about the same quality
+    while (true){
+        int best = -1;
+        double bestExtra = 0;
+
+        for (int i = (fpsFixed ? 1 : 0); i < count; i++){
+            if (levels.at(i) + 1 >= presets.at(i).count()) continue;
+
+            double extra = cost(i, levels.at(i) + 1, fpsLimits.at(i)) - cost(i, levels.at(i), fpsLimits.at(i));
+            if (total + extra > secondsLeft) continue;
+
+            if (best < 0 || levels.at(i) < levels.at(best) || (levels.at(i) == levels.at(best) && extra < bestExtra)){
+                best = i;
+                bestExtra = extra;
+            }
+        }
+
+        if (best < 0) break;
+
+        levels[best]++;
+        total += bestExtra;
+    }
+
+    for (int i = 0; i < count; i++){
+        jobs[i].preset = presetOf(i, levels.at(i));
+        jobs[i].plannedFpsLimit = fpsLimits.at(i);
+    }
+
+    return total;
+}
+
+void DeadlinePlanner::addSpeedSample(const VideoJob &job, int pass, double speed){
+    double pixelsPerVideoSecond = job.effectiveFps() * job.outputWidth() * job.outputHeight();
+    if (speed <= 0 || pixelsPerVideoSecond <= 0) return;
+
+    const EncoderBackend *encoder = EncoderBackend::byId(job.encoder);
+    double cost = encoder->relativeCost(pass, job.preset);
+    if (pass == encoder->passCount()) cost *= 1 + job.extraTargets.count();
+
+    double sample = speed * pixelsPerVideoSecond / cost;
+
+    //Smoothed, the speed ffmpeg shows at the start of a pass is always a bit off
+    pixelsPerSecond = (pixelsPerSecond <= 0 ? sample : pixelsPerSecond * 0.9 + sample * 0.1);
+}
@@ -0,0 +1,37 @@
+#ifndef DEADLINEPLANNER_H
+#define DEADLINEPLANNER_H
+
+#include <QDateTime>
+#include <QList>
+#include "videojob.h"
+
+//Picks the preset (and lowers the fps if really needed) of every job left so that the whole queue
+//is done before a deadline, with the best quality the time allows
+//The encoding time of a job is estimated from its pixels and from the speed measured on the previous passes
+class DeadlinePlanner
+{
+public:
+    //An invalid deadline turns the planner off, the jobs keep the usual settings of their encoder
+    void setDeadline(const QDateTime &deadline);
+    QDateTime deadline() const;
+    bool isActive() const;
+
+    //Sets the preset and plannedFpsLimit of every job, the first one is the current job
+    //Once its first pass is done, its preset and fps are kept (the stats of the pass 1 are made for them)
+    //Returns the estimated time left for the whole queue, in seconds
+    double plan(QList<VideoJob> &jobs, bool currentPass1Done);
+
+    //Updates the measured speed with the "speed=" of ffmpeg (1.5 for "1.5x") while a pass of the job runs
+    void addSpeedSample(const VideoJob &job, int pass, double speed);
+
+private:
+    //Estimated time in seconds for the passes of the job left to do, with the given preset and fps limit
+    double jobCost(const VideoJob &job, const QString &preset, int plannedFpsLimit, bool withPass1) const;
+
+    QDateTime deadlineTime;
+
+    //Pixels encoded per second at x264 medium, guessed from the cores until ffmpeg tells the real speed
+    double pixelsPerSecond = 0;
+};
+
+#endif // DEADLINEPLANNER_H
@@ -0,0 +1,219 @@
+#include "encoderbackend.h"
+#include <QFile>
+#include <QFileInfo>
+#include <QThread>
+#include <QtGlobal>
+#include <QtMath>
+
+//qcomp of x264 and x265 (0.6 by default) : 0 = every frame gets the same bits, 1 = every frame gets the same quality
+static const double qcomp = 0.6;
+
+QStringList EncoderBackend::audioArgs(int audioBitrateKbps) const{
+    return { "-c:a", "aac", "-b:a", QString::number(audioBitrateKbps) + "k" };
+}
+
+//x264 and x265 write one line per frame in their stats, ex : in:0 out:0 type:I dur:2 cpts:0 q:27.50 tex:81523 mv:6061 misc:312 ...
+//The bits of a frame times its qscale (doubles every 6 qp) is what it needs at a common quantizer,
+//then each frame weighs complexity^qcomp, the same way the rate control splits the bits between the frames of a video
+static double rateControlComplexity(const QString &statsFile){
+    QFile file(statsFile);
+    if (!file.open(QIODevice::ReadOnly | QIODevice::Text)) return -1;
+
+    double complexity = 0;
+
+    while (!file.atEnd()){
+        const QList<QByteArray> fields = file.readLine().split(' ');
+        double q = -1;
+        double bits = 0;
+
+        for (const QByteArray &field : fields){
+            if (field.startsWith("q:")){
+                q = field.mid(2).toDouble();
+            }else if (field.startsWith("tex:") || field.startsWith("mv:") || field.startsWith("misc:")){
+                bits += field.mid(field.indexOf(':') + 1).toDouble();
+            }
+        }
+
+        //The "#options:" line
+        if (q < 0) continue;
+
+        double qscale = 0.85 * qPow(2, (q - 12) / 6);
+        complexity += qPow(bits * qscale, qcomp);
+    }
+
+    return complexity > 0 ? complexity : -1;
+}
+
+//H.264, works everywhere, the historical encoder of the app
+class X264Backend : public EncoderBackend
+{
+public:
+    QString id() const override { return "libx264"; }
+    QString label() const override { return "H.264 (libx264)"; }
+
+    //Same preset for both passes, the pass 2 refuses stats made with other b-frames, weightp or mbtree settings
+    //The stats file is named through x264-params like x265 does (relative path, started from the stats folder),
+    //ffmpeg would otherwise add the index of the output stream and every extra size would miss its stats
+    QStringList passArgs(int pass, int videoBitrateKbps, const QString &statsPrefix, const QString &preset) const override{
+        QString stats = QFileInfo(statsPrefix).fileName() + ".log";
+
+        QStringList args = { "-c:v", "libx264", "-b:v", QString::number(videoBitrateKbps) + "k",
+                            "-pass", QString::number(pass), "-x264-params", "stats=" + stats,
+                            "-preset", (preset != "" ? preset : "slow") };
+
+        if (pass == 2){
+            args << "-profile:v" << "high" << "-level" << "4.2";
+        }
+        return args;
+    }
+
+    QStringList presets() const override{
+        return { "ultrafast", "superfast", "veryfast", "faster", "fast", "medium", "slow", "slower", "veryslow" };
+    }
+
+    //Rough encoding time of each preset compared to medium, measured on 1080p clips
+    double relativeCost(int pass, const QString &preset) const override{
+        static const double costs[] = { 0.12, 0.2, 0.3, 0.5, 0.7, 1, 1.6, 3.2, 6.5 };
+
+        int index = presets().indexOf(preset != "" ? preset : "slow");
+        double cost = costs[qMax(0, index)];
+
+        //x264 makes the first pass fast by itself (fast first pass), only the b-frames and lookahead of the preset are left
+        if (pass == 1) return 0.25 + 0.1 * cost;
+
+        return cost;
+    }
+
+    QStringList threadArgs() const override { return { "-threads", "0" }; }
+
+    bool namedStats() const override { return true; }
+
+    QStringList statsFiles(const QString &statsPrefix) const override{
+        return { statsPrefix + ".log", statsPrefix + ".log.mbtree" };
+    }
+
+    double statsComplexity(const QString &statsPrefix) const override{
+        return rateControlComplexity(statsPrefix + ".log");
+    }
+};
+
+//H.265, smaller files than x264 for the same quality but slower
+class X265Backend : public EncoderBackend
+{
+public:
+    QString id() const override { return "libx265"; }
+    QString label() const override { return "H.265 (libx265)"; }
+
+    //x265 handles its stats file by itself, the path is relative because x265-params splits on ':'
+    //(which breaks windows paths), the process is started from the stats folder
+    //Same preset for both passes too, like x264
+    QStringList passArgs(int pass, int videoBitrateKbps, const QString &statsPrefix, const QString &preset) const override{
+        QString stats = QFileInfo(statsPrefix).fileName() + ".x265.log";
+
+        QStringList args = { "-c:v", "libx265", "-b:v", QString::number(videoBitrateKbps) + "k",
+                            "-x265-params", "pass=" + QString::number(pass) + ":stats=" + stats,
+                            "-preset", (preset != "" ? preset : "slow") };
+
+        if (pass == 2){
+            //hvc1 tag so that the file can be read by apple devices
+            args << "-tag:v" << "hvc1";
+        }
+        return args;
+    }
+
+    //x265 keeps the full preset in the pass 1 (slow-firstpass)
+    double relativeCost(int pass, const QString &preset) const override{
+        Q_UNUSED(pass);
+        Q_UNUSED(preset);
+        return 6;
+    }
+
+    bool namedStats() const override { return true; }
+
+    QStringList statsFiles(const QString &statsPrefix) const override{
+        return { statsPrefix + ".x265.log", statsPrefix + ".x265.log.cutree" };
+    }
+
+    double statsComplexity(const QString &statsPrefix) const override{
+        return rateControlComplexity(statsPrefix + ".x265.log");
+    }
+};
+
+//AV1 with SVT-AV1, scales really well on multiple cores
+//The ffmpeg wrapper of SVT-AV1 doesn't expose its multi-pass stats, its VBR mode is used in a single pass
+class SvtAv1Backend : public EncoderBackend
+{
+public:
+    QString id() const override { return "libsvtav1"; }
+    QString label() const override { return "AV1 (libsvtav1)"; }
+
+    int passCount() const override { return 1; }
+
+    QStringList passArgs(int pass, int videoBitrateKbps, const QString &statsPrefix, const QString &preset) const override{
+        Q_UNUSED(pass);
+        Q_UNUSED(statsPrefix);
+        Q_UNUSED(preset);
+        return { "-c:v", "libsvtav1", "-b:v", QString::number(videoBitrateKbps) + "k", "-preset", "8" };
+    }
+
+    double relativeCost(int pass, const QString &preset) const override{
+        Q_UNUSED(pass);
+        Q_UNUSED(preset);
+        return 1.2;
+    }
+};
+
+//VP9, only goes into webm with opus audio
+class Vp9Backend : public EncoderBackend
+{
+public:
+    QString id() const override { return "libvpx-vp9"; }
+    QString label() const override { return "VP9 (libvpx-vp9)"; }
+
+    QString containerExtension() const override { return "webm"; }
+
+    QStringList passArgs(int pass, int videoBitrateKbps, const QString &statsPrefix, const QString &preset) const override{
+        Q_UNUSED(preset);
+
+        //The analysis pass can be a lot faster without changing the result much
+        return { "-c:v", "libvpx-vp9", "-b:v", QString::number(videoBitrateKbps) + "k",
+                "-pass", QString::number(pass), "-passlogfile", statsPrefix,
+                "-deadline", "good", "-cpu-used", (pass == 2 ? "2" : "4") };
+    }
+
+    double relativeCost(int pass, const QString &preset) const override{
+        Q_UNUSED(preset);
+        return pass == 2 ? 4 : 1.5;
+    }
+
+    //libvpx only uses one core if not told otherwise
+    QStringList threadArgs() const override{
+        return { "-row-mt", "1", "-tile-columns", "2", "-threads", QString::number(QThread::idealThreadCount()) };
+    }
+
+    QStringList audioArgs(int audioBitrateKbps) const override{
+        return { "-c:a", "libopus", "-b:a", QString::number(audioBitrateKbps) + "k" };
+    }
+
+    //Written by ffmpeg itself, named after the index of the stream : the video is the first one of a single output
+    QStringList statsFiles(const QString &statsPrefix) const override{
+        return { statsPrefix + "-0.log" };
+    }
+};
+
+const QList<const EncoderBackend*>& EncoderBackend::all(){
+    static const X264Backend x264;
+    static const X265Backend x265;
+    static const SvtAv1Backend svtAv1;
+    static const Vp9Backend vp9;
+
+    static const QList<const EncoderBackend*> backends = { &x264, &x265, &svtAv1, &vp9 };
+    return backends;
+}
+
+const EncoderBackend* EncoderBackend::byId(const QString &id){
+    for (const EncoderBackend *backend : all()){
+        if (backend->id() == id) return backend;
+    }
+    return all().first();
+}
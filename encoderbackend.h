@@ -0,0 +1,63 @@
+#ifndef ENCODERBACKEND_H
+#define ENCODERBACKEND_H
+
+#include <QList>
+#include <QString>
+#include <QStringList>
+
+//Video encoder used by ffmpeg to compress the videos
+//Each backend builds its own args for every pass, knows where its stats files go and what container it needs
+class EncoderBackend
+{
+public:
+    virtual ~EncoderBackend() = default;
+
+    //Name of the ffmpeg encoder, also used to save the choice in the settings
+    virtual QString id() const = 0;
+
+    //Name shown in the ui
+    virtual QString label() const = 0;
+
+    //1 = single pass, 2 = two-pass (analysis pass then encoding pass)
+    virtual int passCount() const { return 2; }
+
+    //Extension of the output files, without the dot
+    virtual QString containerExtension() const { return "mp4"; }
+
+    //Video encoder args for the given pass (1 to passCount()), the last one is the one writing the file
+    //statsPrefix is the absolute path (without extension) used for the stats files of the passes
+    //preset is one of presets(), empty = the usual preset of the backend
+    virtual QStringList passArgs(int pass, int videoBitrateKbps, const QString &statsPrefix, const QString &preset = "") const = 0;
+
+    //Presets the deadline planner can choose from, from the fastest to the best quality, empty if it can't choose
+    virtual QStringList presets() const { return {}; }
+
+    //Time to encode one pixel in the given pass, relative to x264 medium, empty preset = the usual one
+    virtual double relativeCost(int pass, const QString &preset) const { Q_UNUSED(pass); Q_UNUSED(preset); return 1; }
+
+    //Args to use every core of the computer
+    virtual QStringList threadArgs() const { return {}; }
+
+    //Audio encoder args of the output file
+    virtual QStringList audioArgs(int audioBitrateKbps) const;
+
+    //Files created by the passes, to remove them once the job is done
+    virtual QStringList statsFiles(const QString &statsPrefix) const { Q_UNUSED(statsPrefix); return {}; }
+
+    //True if the backend names its stats file itself, every output of the same pass 2 command can then read it
+    //Otherwise ffmpeg adds the index of the output stream to the name, a second output would look for stats
+    //that the pass 1 never wrote, so each size needs its own pass 2 command
+    virtual bool namedStats() const { return false; }
+
+    //Complexity of the video read from the stats of its pass 1, to split a size limit shared by several videos
+    //Only compared between videos, -1 if the backend can't read its stats
+    virtual double statsComplexity(const QString &statsPrefix) const { Q_UNUSED(statsPrefix); return -1; }
+
+    //Every available backend, the first one is the default
+    static const QList<const EncoderBackend*>& all();
+
+    //Returns the default backend (x264) if the id is unknown
+    static const EncoderBackend* byId(const QString &id);
+};
+
+#endif // ENCODERBACKEND_H
@@ -0,0 +1,164 @@
+#include "joblog.h"
+#include <QCoreApplication>
+#include <QThread>
+#include <QDir>
+#include <QFileInfo>
+
+//Max size of an unfinished line before it's forced out, so that a weird output can't grow the memory forever
+static const int maxPendingSize = 64 * 1024;
+
+//Single background thread writing every log file, the disk is never touched by the ui thread
+static QThread* writerThread(){
+    static QThread *thread = nullptr;
+
+    if (!thread){
+        thread = new QThread();
+        thread->start(QThread::LowPriority);
+
+        //Lets the pending writes finish before closing the app
+        QObject::connect(qApp, &QCoreApplication::aboutToQuit, [](){
+            thread->quit();
+            thread->wait();
+        });
+    }
+
+    return thread;
+}
+
+JobLogWriter::JobLogWriter(const QString &filePath)
+    : file(this)
+{
+    file.setFileName(filePath);
+}
+
+void JobLogWriter::write(const QByteArray &chunk){
+
+    //Opened on the first write so that it's done in the writer thread
+    if (!file.isOpen()){
+        QDir().mkpath(QFileInfo(file.fileName()).absolutePath());
+        if (!file.open(QIODevice::WriteOnly | QIODevice::Append)) return;
+    }
+
+    file.write(chunk);
+    file.flush();
+}
+
+JobLog::JobLog(const QString &filePath, int capacity, QObject *parent)
+    : QObject(parent)
+    , path(filePath)
+{
+    lines.resize(capacity > 0 ? capacity : 1);
+
+    writer = new JobLogWriter(filePath);
+    writer->moveToThread(writerThread());
+
+    //Queued since the writer lives in another thread, the chunks are written in order
+    connect(this, &JobLog::chunkReady, writer, &JobLogWriter::write);
+}
+
+void JobLog::removeOldLogs(const QString &folder, int keep){
+    const QFileInfoList logs = QDir(folder).entryInfoList({ "*.log" }, QDir::Files, QDir::Time);
+
+    //Sorted from the newest
+    for (int i = keep; i < logs.count(); i++){
+        QFile::remove(logs.at(i).absoluteFilePath());
+    }
+}
+
+JobLog::~JobLog(){
+    //Deleted by the writer thread once every queued chunk has been written
+    writer->deleteLater();
+}
+
+void JobLog::append(const QByteArray &data, const QObject *source){
+    if (data.isEmpty()) return;
+
+    //ffmpeg ends its progress lines with \r and the other ones with \n
+    QByteArray &pending = sources[source].pending;
+    pending += data;
+
+    int start = 0;
+    for (int i = 0; i < pending.size(); i++){
+        char c = pending.at(i);
+        if (c == '\n' || c == '\r'){
+            if (i > start){
+                pushLine(QString::fromUtf8(pending.constData() + start, i - start), source);
+            }
+            start = i + 1;
+        }
+    }
+
+    //The file gets every finished line as is, the lines of two processes are never mixed
+    if (start > 0) emit chunkReady(pending.left(start));
+    pending.remove(0, start);
+
+    if (pending.size() > maxPendingSize){
+        emit chunkReady(pending);
+        pushLine(QString::fromUtf8(pending), source);
+        pending.clear();
+    }
+}
+
+void JobLog::closeSource(const QObject *source){
+    if (!sources.contains(source)) return;
+
+    QByteArray pending = sources.value(source).pending;
+    if (!pending.isEmpty()){
+        emit chunkReady(pending + "\n");
+        pushLine(QString::fromUtf8(pending), source);
+    }
+    sources.remove(source);
+
+    //Another process can get the same address later, its tail must not show these lines
+    for (Line &line : lines){
+        if (line.source == source) line.source = nullptr;
+    }
+}
+
+void JobLog::appendCommand(const QString &program, const QStringList &args){
+    emit chunkReady(("\n> " + program + " " + args.join(" ") + "\n").toUtf8());
+}
+
+QString JobLog::lastProgressLine(const QObject *source) const{
+    return sources.value(source).lastProgress;
+}
+
+QStringList JobLog::tail(int count, const QObject *source) const{
+    QStringList result;
+
+    //From the newest line, until enough lines of the source are found
+    for (int i = lineCount - 1; i >= 0 && result.count() < count; i--){
+        const Line &line = lines.at((head + i) % lines.size());
+        if (!source || line.source == source) result.prepend(line.text);
+    }
+
+    return result;
+}
+
+QString JobLog::filePath() const{
+    return path;
+}
+
+void JobLog::pushLine(const QString &line, const QObject *source){
+    QString l = line.trimmed();
+    if (l == "") return;
+
+    //Progress lines, ex : frame=  123 fps= 60 q=28.0 size=    1024kB time=00:00:05.12 bitrate=1638.4kbits/s speed=1.00x
+    if (l.startsWith("frame=") || l.startsWith("size=")){
+        sources[source].lastProgress = l;
+        return;
+    }
+
+    Line entry;
+    entry.source = source;
+    entry.text = l;
+
+    if (lineCount < lines.size()){
+        lines[(head + lineCount) % lines.size()] = entry;
+        lineCount++;
+    }else{
+        //Full, overwrites the oldest line
+        lines[head] = entry;
+        head = (head + 1) % lines.size();
+    }
+}
@@ -0,0 +1,86 @@
+#ifndef JOBLOG_H
+#define JOBLOG_H
+
+#include <QObject>
+#include <QFile>
+#include <QHash>
+#include <QStringList>
+#include <QVector>
+
+//Writes the log chunks into the log file, lives in a background thread shared by every log
+class JobLogWriter : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit JobLogWriter(const QString &filePath);
+
+public slots:
+    void write(const QByteArray &chunk);
+
+private:
+    QFile file;
+};
+
+//Log of one compression job (ffprobe + every ffmpeg pass)
+//Only keeps a fixed amount of the last lines in memory, the progress lines of ffmpeg (frame=... time=...)
+//are not kept since only the last one is useful, the complete output is streamed to a file
+//Several processes can write in the same log at once (parts encoded in parallel) : each source has its own
+//unfinished line and last progress line, and the lines kept remember their source
+class JobLog : public QObject
+{
+    Q_OBJECT
+
+public:
+    JobLog(const QString &filePath, int capacity = 64, QObject *parent = nullptr);
+    ~JobLog();
+
+    //Adds a raw chunk of stderr of the given source (usually its QProcess), lines can be split between two chunks
+    void append(const QByteArray &data, const QObject *source = nullptr);
+
+    //Adds the command that is about to be executed, only goes into the file
+    void appendCommand(const QString &program, const QStringList &args);
+
+    //Last progress line sent by the source
+    QString lastProgressLine(const QObject *source = nullptr) const;
+
+    //Last non progress lines of the source, or of every source if null, the oldest first
+    QStringList tail(int count, const QObject *source = nullptr) const;
+
+    //The source is done (its process is about to be deleted) : its unfinished line is kept and its state forgotten
+    void closeSource(const QObject *source);
+
+    QString filePath() const;
+
+    //Removes the oldest .log files of the folder to only keep the given number, a big queue makes one per video
+    static void removeOldLogs(const QString &folder, int keep);
+
+signals:
+    void chunkReady(const QByteArray &chunk);
+
+private:
+    void pushLine(const QString &line, const QObject *source);
+
+    struct Line {
+        const QObject *source = nullptr;
+        QString text;
+    };
+
+    //Unfinished line waiting for the rest of its chunk
+    struct Source {
+        QByteArray pending;
+        QString lastProgress;
+    };
+
+    QString path;
+    JobLogWriter *writer;
+
+    //Ring buffer of the last lines
+    QVector<Line> lines;
+    int head = 0;
+    int lineCount = 0;
+
+    QHash<const QObject*, Source> sources;
+};
+
+#endif // JOBLOG_H
@@ -1,11 +1,15 @@
 #include "mainwindow.h"
 #include "./ui_mainwindow.h"
+#include "compressionengine.h"
+#include "encoderbackend.h"
+#include "previewencoder.h"
+#include "processpool.h"
+#include "perceptualhash.h"
+#include "mp4probe.h"
+#include "videoscanner.h"
 #include "QFileDialog"
 #include "QProcess"
 #include "QStandardPaths"
-#include "QJsonDocument"
-#include "QJsonObject"
-#include "QJsonArray"
 #include "QToolTip"
 #include "QHelpEvent"
 #include "QSettings"
@@ -13,6 +17,20 @@
 #include <QDesktopServices>
 #include <QUrl>
 #include <QStyleFactory>
+#include <QInputDialog>
+#include <QActionGroup>
+#include <QDialog>
+#include <QVBoxLayout>
+#include <QLabel>
+#include <QPushButton>
+#include <QMouseEvent>
+#include <QPixmapCache>
+#include <QThread>
+#include <QThreadPool>
+#include <QTimer>
+#include <QHash>
+#include <QDateTime>
+#include <QSet>
 
 //QSettings default valuess
 double defaultSizeLimit = 50;
@@ -20,6 +38,7 @@ int defaultIndexSizeType = 5;
 QString defaultVideoFolder = QDir::homePath();
 QString defaultOutputFolder = "";
 int defaultIntIndex = 0;
+QString defaultEncoder = "libx264";
 
 //Default window values
 int windowHeight;
@@ -39,19 +58,81 @@ struct LogInfo {
     QString fileCount = "";
     QString step = "";  //Retrieving video data | Pass 1 | Pass 2
     QString targetSize = "";
-    QString encoder = "lib264";
-    QString ffmpegOutput = "";
+    QString encoder = "libx264";
+    QString plan = ""; //settings chosen by the deadline planner, empty without deadline
 
+    //Used for the progress bar, pass is 0 while retrieving the video data
+    int pass = 0;
+    int passCount = 2;
+    double passProgress = 0;
+
+};
+
+//Custom data stored in the items of the video list, Qt::UserRole is the file path
+enum VideoItemRole {
+    TrimStartRole = Qt::UserRole + 1,
+    TrimEndRole,
+    EncoderRole,    //empty = the encoder chosen in the Encoder menu
+    SpriteRole,     //path of the sprite sheet shown when hovering the item, empty until generated
+    DuplicateOfRole //path of the video this one looks like, empty if it's not a near-duplicate
 };
 
-//Stores all of the jobs required to do ( each compression has 3)
-QList<VideoJob> videoJobs;
+//Items of the video list by file path
+QHash<QString, QListWidgetItem*> videoItems;
+
+//Runs the thumbnails and sprite sheets generation in the background, a few at a time
+ProcessPool *backgroundPool = nullptr;
+
+//Walks the folders added with Videos > Add Folder..., in the threads of its own pool
+VideoScanner *folderScanner = nullptr;
+
+//Reads the boxes of the MP4 / MOV files for their sprite sheet, the files can be on a slow drive
+QThreadPool *probePool = nullptr;
+
+//Number of frames in the sprite sheets and width of each frame
+const int spriteFrameCount = 10;
+const int spriteTileWidth = 160;
+
+//Floating label showing the frame of the sprite sheet under the mouse
+QLabel *spritePreview = nullptr;
+
+//Perceptual hashes of the videos (from their sprite sheet) and index of the ones that are not duplicates
+QHash<QString, VideoHash> videoHashes;
+DuplicateIndex duplicateIndex;
+
+//If the near-duplicates are left out of the compression
+bool skipDuplicates = true;
+
+//If the black bars of the videos are detected and cropped (a whole decoding more for each video, off by default)
+bool detectCrop = false;
+
+//If the static frames of the videos (screen recordings, slides) are dropped when there are enough of them (off by default)
+bool decimate = false;
+
+//If the videos too long for the size limit are split into parts instead of getting an unwatchable bitrate
+bool splitIntoParts = false;
+
+//If the size limit is for the whole list instead of each video, the bits then go to the most complex videos
+bool shareSize = false;
+
+//Time available to compress the whole list in seconds, 0 = no deadline
+double deadlineSeconds = 0;
+
+//Sizes of the outputs of every video, in the unit of the size limit, empty = only the size limit
+//ex : 8, 25, 50 => clip_8MB.mp4, clip_25MB.mp4 and clip_50MB.mp4
+QList<double> sizeTiers;
+
+//Runs the compression in its own thread, the ui only receives its signals
+CompressionEngine *engine = nullptr;
+QThread *engineThread = nullptr;
 
 //Current used LogInfo
 LogInfo currentLog;
 
-//Number of videos that needs to be compressed
-int totalVideosCompressing;
+//The signals of the engine only change currentLog, the display is refreshed at a fixed rate
+//if something changed, so that the ui costs the same however many updates ffmpeg sends
+const int uiRefreshRateHz = 10;
+bool infoChanged = false;
 
 //To prevent false positive with how ffmpeg outputs updates for the progress bar
 // if the new value is smaller than the old one, it skips
@@ -86,10 +167,43 @@ MainWindow::MainWindow(QWidget *parent)
 
     //Enable the custom events for the thumbnails preview
     ui->videoList->viewport()->installEventFilter(this);
+    ui->videoList->viewport()->setMouseTracking(true);
+
+    spritePreview = new QLabel(this, Qt::ToolTip);
+    spritePreview->setFrameStyle(QFrame::Box);
+    spritePreview->hide();
+
+    //Half of the cores, the other half keeps the app and the compression responsive
+    backgroundPool = new ProcessPool(qMax(1, QThread::idealThreadCount() / 2), this);
+    probePool = new QThreadPool(this);
 
     QCoreApplication::setOrganizationName("MathMoth"); // me :)
     QCoreApplication::setApplicationName("GUIVideoCompressor");
 
+    //Creates the cache folders for the thumbnails and for the pass encoding files of ffmpeg
+    QDir().mkpath(QStandardPaths::writableLocation(QStandardPaths::CacheLocation) + "/thumbnails");
+    QDir().mkpath(QStandardPaths::writableLocation(QStandardPaths::CacheLocation) + "/tempffmpeg/");
+
+    //The videos found are added as they come, the folder can be huge
+    folderScanner = new VideoScanner(this);
+
+    connect(folderScanner, &VideoScanner::videosFound, this, [=](QStringList filePaths){
+        ui->videoList->setUpdatesEnabled(false);
+        for (const QString &filePath : filePaths){
+            addVideo(filePath);
+        }
+        ui->videoList->setUpdatesEnabled(true);
+
+        currentLog.overrideMessage = "Looking for videos... " + QString::number(ui->videoList->count()) + " in the list";
+        updateInfo();
+    });
+
+    connect(folderScanner, &VideoScanner::finished, this, [=](int videoCount){
+        currentLog.overrideMessage = QString::number(videoCount) + " videos found, "
+                                     + QString::number(ui->videoList->count()) + " in the list";
+        updateInfo();
+    });
+
     //Settings setup
     QSettings settings;
 
@@ -136,6 +250,55 @@ MainWindow::MainWindow(QWidget *parent)
        defaultIntIndex = storedIndex;
     }
 
+    if (settings.contains("sizeTiers")){
+        for (const QString &tier : settings.value("sizeTiers").toString().split(',', Qt::SkipEmptyParts)){
+            if (tier.toDouble() > 0) sizeTiers << tier.toDouble();
+        }
+    }
+
+    if (settings.contains("skipDuplicates")){
+        skipDuplicates = settings.value("skipDuplicates").toBool();
+    }
+    ui->actionSkipDuplicates->setChecked(skipDuplicates);
+
+    if (settings.contains("detectCrop")){
+        detectCrop = settings.value("detectCrop").toBool();
+    }
+    ui->actionDetectCrop->setChecked(detectCrop);
+
+    if (settings.contains("decimate")){
+        decimate = settings.value("decimate").toBool();
+    }
+    ui->actionDecimate->setChecked(decimate);
+
+    if (settings.contains("splitIntoParts")){
+        splitIntoParts = settings.value("splitIntoParts").toBool();
+    }
+    ui->actionSplitIntoParts->setChecked(splitIntoParts);
+
+    if (settings.contains("shareSize")){
+        shareSize = settings.value("shareSize").toBool();
+    }
+    ui->actionShareSize->setChecked(shareSize);
+
+    if (settings.contains("encoder")){
+        defaultEncoder = EncoderBackend::byId(settings.value("encoder").toString())->id();
+    }
+
+    //Fills the Encoder menu, only one can be checked at a time
+    QActionGroup *encoderGroup = new QActionGroup(this);
+    for (const EncoderBackend *backend : EncoderBackend::all()){
+        QAction *action = ui->menuEncoder->addAction(backend->label());
+        action->setCheckable(true);
+        action->setChecked(backend->id() == defaultEncoder);
+        encoderGroup->addAction(action);
+
+        QString encoderId = backend->id();
+        connect(action, &QAction::triggered, this, [=](){
+            setDefaultEncoder(encoderId);
+        });
+    }
+
     //Saves the default settings values
     ui->lineEdit_outputFolder->setText(defaultOutputFolder);
     ui->comboBox_finalSizeType->setCurrentIndex(defaultIndexSizeType);
@@ -156,10 +319,76 @@ MainWindow::MainWindow(QWidget *parent)
 
     //Check if the dependencies are ok before starting up
     refreshDependencies();
+
+    //Starts the engine in its own thread
+    engineThread = new QThread(this);
+    engine = new CompressionEngine();
+    engine->moveToThread(engineThread);
+    connect(engineThread, &QThread::finished, engine, &QObject::deleteLater);
+
+    connect(engine, &CompressionEngine::jobStarted, this, [=](int fileIndex, int fileCount, QString fileName, QString encoder){
+        currentLog.overrideMessage = "";
+        currentLog.fileIndex = QString::number(fileIndex);
+        currentLog.fileCount = QString::number(fileCount);
+        currentLog.fileName = fileName;
+        currentLog.encoder = encoder;
+        infoChanged = true;
+    });
+
+    connect(engine, &CompressionEngine::stepChanged, this, [=](QString step, int pass, int passCount){
+        currentLog.step = step;
+        currentLog.pass = pass;
+        currentLog.passCount = passCount;
+        currentLog.passProgress = 0;
+        infoChanged = true;
+    });
+
+    connect(engine, &CompressionEngine::progressChanged, this, [=](double passProgress){
+        currentLog.passProgress = passProgress;
+        infoChanged = true;
+    });
+
+    connect(engine, &CompressionEngine::planChanged, this, [=](QString plan){
+        currentLog.plan = plan;
+        infoChanged = true;
+    });
+
+    connect(engine, &CompressionEngine::jobFailed, this, [=](QString error){
+        currentLog.overrideMessage = error;
+        updateInfo();
+    });
+
+    connect(engine, &CompressionEngine::allFinished, this, [=](){
+        currentLog.overrideMessage = "Succesfully compressed all of the files !";
+        updateInfo();
+        infoChanged = false;
+        oldProgress = 100;
+        ui->progressBar->setValue(100);
+    });
+
+    engineThread->start();
+
+    //Refreshes the display at a fixed rate
+    QTimer *refreshTimer = new QTimer(this);
+    connect(refreshTimer, &QTimer::timeout, this, [=](){
+        if (!infoChanged) return;
+        infoChanged = false;
+        updateInfo();
+    });
+    refreshTimer->start(1000 / uiRefreshRateHz);
 }
 
 MainWindow::~MainWindow()
 {
+    //The probes left would send their result to a window being destroyed
+    probePool->clear();
+    probePool->waitForDone();
+
+    //Kills the running ffmpeg processes and waits for the engine thread to end
+    QMetaObject::invokeMethod(engine, &CompressionEngine::abort);
+    engineThread->quit();
+    engineThread->wait();
+
     delete ui;
 }
 
@@ -174,12 +403,12 @@ void MainWindow::on_button_AddVideos_pressed()
         videoFolder = QDir::homePath();
     }
 
-    //Open the dialog and select all of the files
+    //Open the dialog and select all of the files, the files are then checked by their content
     QStringList files = QFileDialog::getOpenFileNames(
         this,
-        "Select mp4 files",
+        "Select video files",
         videoFolder,
-        "*.mp4"
+        "Videos (*.mp4 *.mov *.m4v *.mkv *.webm *.avi *.ts *.m2ts *.mts *.flv *.mpg *.mpeg *.wmv);;All files (*)"
         );
 
     if (files.isEmpty())return;
@@ -188,94 +417,551 @@ void MainWindow::on_button_AddVideos_pressed()
     QString folderPath = QFileInfo(files.at(0)).absolutePath();
     settings.setValue("inputFolder",folderPath);
 
-    //Creates if needed and store the cache folder for the thumbnails
-    QString cachePath = QStandardPaths::writableLocation(QStandardPaths::CacheLocation);
-    QString thumbnailDir = cachePath + "/thumbnails";
-    QDir().mkpath(thumbnailDir);
-
-    //Also creates the cache path for the pass encoding files of ffmpeg
-    QDir().mkpath(QStandardPaths::writableLocation(QStandardPaths::CacheLocation) + "/tempffmpeg/");
-
     //Add every file into the list, without any thumbnail
     for (const QString &filePath : files.toVector()){
+        if (fileContainer(filePath).isEmpty()) continue;
+        addVideo(filePath);
+    }
+}
 
-        QFileInfo fileName(filePath);
+//Adds every video of a folder and of its subfolders, the videos show up in the list while the folder is walked
+void MainWindow::on_actionAddFolder_triggered()
+{
+    QString videoFolder = (QDir(defaultVideoFolder).exists() ? defaultVideoFolder : QDir::homePath());
 
-        // Check if the list doesn't already contain the element
-        bool alreadyExisting = false;
+    QString folder = QFileDialog::getExistingDirectory(this, "Select a folder of videos", videoFolder);
+    if (folder == "") return;
+
+    QSettings settings;
+    settings.setValue("inputFolder", folder);
+
+    currentLog.overrideMessage = "Looking for videos in " + folder + "...";
+    updateInfo();
+
+    folderScanner->scan(folder);
+}
+
+//Adds a video to the list, its thumbnail and sprite sheet are generated in the background
+//Returns false if the video is already in the list
+bool MainWindow::addVideo(const QString &filePath)
+{
+    //Cache folder of the thumbnails, created at startup
+    QString thumbnailDir = QStandardPaths::writableLocation(QStandardPaths::CacheLocation) + "/thumbnails";
+
+    QFileInfo fileName(filePath);
+
+    // Check if the list doesn't already contain the element
+    bool alreadyExisting = videoItems.contains(filePath);
+
+    if (alreadyExisting) return false;
+
+    //Creating/Adding the item to the list
+    QListWidgetItem *item = new QListWidgetItem();
+    item->setText(fileName.fileName());
+    item->setToolTip(filePath);
+    item->setData(Qt::UserRole,filePath);
+
+    ui->videoList->addItem(item);
+    videoItems.insert(filePath, item);
+
+    //Setting the icon to the generated thumbnail
+    //Videos of different folders can have the same name, the hash of the path keeps their thumbnails apart
+    QString cacheName = QString::number(qHash(filePath), 16) + "_" + fileName.fileName();
+    QString tempThumbnailPath = thumbnailDir + "/" + cacheName + ".jpg";
+
+    //FFMPEG command to generate the thumbnail
+    QStringList args = {
+        "-y",
+        "-i", filePath,
+        "-ss", "00:00:01",
+        "-vframes", "1",
+        tempThumbnailPath
+    };
+
+    //Called when the process is finished, to add the generated thumbnail to the item as an icon
+    backgroundPool->enqueue(ffmpegPath, args, [=](int exitCode, QProcess*){
+
+        //The video could have been removed from the list in the meantime
+        QListWidgetItem *videoItem = videoItems.value(filePath);
+        if (!videoItem) return;
+
+        if (exitCode == 0) {
+            QPixmap pixmap(tempThumbnailPath);
+            pixmap = pixmap.scaled(64, 64, Qt::KeepAspectRatio, Qt::SmoothTransformation);
+            videoItem->setIcon(QIcon(pixmap));
+
+            //Add the image to the tooltip using html thingie
+            QString tooltip =
+                "<html>"
+                "<b>"+videoItem->toolTip()+"<b>" +
+                "<img src=\"file:///" + tempThumbnailPath + "\" width=\"400\"/><br/>"+
+                "</html>";
+
+            videoItem->setToolTip(tooltip);
+
+            // QFile thumbnail(tempThumbnailPath);
+            // if (thumbnail.exists())
+            //     thumbnail.moveToTrash();
+
+        } else {
+            currentLog.overrideMessage = "FFMPEG error while retrieving the thumbnail of the videos !";
 
-        for (int i = 0 ; i < ui->videoList->count(); i ++){
-            QListWidgetItem *item = ui->videoList->item(i);
-            if (item->data(Qt::UserRole) == filePath){
-                alreadyExisting = true;
-                break;
-            }
         }
+    });
 
-        if (alreadyExisting)break;
+    generateSprite(filePath, thumbnailDir + "/" + cacheName + ".sprite.jpg");
+
+    return true;
+}
 
-        //Creating/Adding the item to the list
-        QListWidgetItem *item = new QListWidgetItem();
-        item->setText(fileName.fileName());
-        item->setToolTip(filePath);
-        item->setData(Qt::UserRole,filePath);
 
-        ui->videoList->addItem(item);
+//Generates the sprite sheet of a video : frames evenly spread on the whole video, side by side in one image
+//Shown when hovering the video in the list, the frame depends on the position of the mouse
+void MainWindow::generateSprite(QString filePath, QString spritePath){
 
-        //Setting the icon to the generated thumbnail
-        QString tempThumbnailPath = thumbnailDir + "/" + fileName.fileName() + ".jpg";
+    //The duration is needed to know the time between two frames
+    auto tileFrames = [=](double duration){
 
-        //Creates the process to get the thumbnail
-        QProcess *process = new QProcess(this);
+        //Each frame is taken at a fixed time (the middle of each tenth of the video), so that a re-export with
+        //other keyframes gives the same moments and the same hashes. -ss before each input jumps to the keyframe
+        //before the time and only decodes from there, then all the frames are tiled in a single image, in one ffmpeg run
+        QStringList args = { "-y" };
+        QStringList chains;
+        QString tiles;
 
-        //Called when the process is finished, to add the generated thumbnail to the item as an icon
-        connect(process, &QProcess::finished, this, [=](int exitCode, QProcess::ExitStatus status){
-            if (exitCode == 0) {
-                QPixmap pixmap(tempThumbnailPath);
-                pixmap = pixmap.scaled(64, 64, Qt::KeepAspectRatio, Qt::SmoothTransformation);
-                item->setIcon(QIcon(pixmap));
+        for (int i = 0; i < spriteFrameCount; i++){
+            double time = duration * (i + 0.5) / spriteFrameCount;
+            args << "-ss" << QString::number(time, 'f', 3) << "-i" << filePath;
 
-                //Add the image to the tooltip using html thingie
-                QString tooltip =
-                    "<html>"
-                    "<b>"+item->toolTip()+"<b>" +
-                    "<img src=\"file:///" + tempThumbnailPath + "\" width=\"400\"/><br/>"+
-                    "</html>";
+            chains << QString("[%1:v]trim=end_frame=1,scale=%2:-2,setsar=1[f%1]").arg(i).arg(spriteTileWidth);
+            tiles += QString("[f%1]").arg(i);
+        }
 
-                item->setToolTip(tooltip);
+        args << "-filter_complex" << chains.join(";") + ";" + tiles + "hstack=inputs=" + QString::number(spriteFrameCount)
+             << "-frames:v" << "1"
+             << spritePath;
 
-                // QFile thumbnail(tempThumbnailPath);
-                // if (thumbnail.exists())
-                //     thumbnail.moveToTrash();
+        backgroundPool->enqueue(ffmpegPath, args, [=](int exitCode, QProcess*){
+            QListWidgetItem *videoItem = videoItems.value(filePath);
+            if (exitCode != 0 || !videoItem) return;
 
-            } else {
-                currentLog.overrideMessage = "FFMPEG error while retrieving the thumbnail of the videos !";
+            //In case an older sprite of the same file is still cached
+            QPixmapCache::remove(spritePath);
+            videoItem->setData(SpriteRole, spritePath);
 
+            //The frames of the sprite are also used to find the near-duplicates
+            VideoHash hash = spriteHash(QImage(spritePath), spriteFrameCount);
+            if (!hash.isEmpty()){
+                videoHashes.insert(filePath, hash);
+                checkDuplicate(videoItem);
             }
-            process->deleteLater();
         });
+    };
+
+    //MP4 and MOV files have it in their boxes, no need to start ffprobe
+    //The boxes are read in the probe pool, a slow or network drive must not freeze the ui
+    probePool->start([=](){
+        VideoInfo info;
+        double mp4Duration = (readMp4Info(filePath, info) ? info.duration : 0);
+
+        QMetaObject::invokeMethod(this, [=](){
+            if (!videoItems.contains(filePath)) return;
+
+            if (mp4Duration > 0){
+                tileFrames(mp4Duration);
+                return;
+            }
+
+            QStringList probeArgs = {
+                "-v", "error",
+                "-show_entries", "format=duration",
+                "-of", "default=noprint_wrappers=1:nokey=1",
+                filePath
+            };
+
+            backgroundPool->enqueue(ffprobePath, probeArgs, [=](int exitCode, QProcess *process){
+                double duration = process->readAllStandardOutput().trimmed().toDouble();
+                if (exitCode != 0 || duration <= 0 || !videoItems.contains(filePath)) return;
+
+                tileFrames(duration);
+            });
+        }, Qt::QueuedConnection);
+    });
+}
+
+//Shows the frame of the sprite sheet under the mouse when hovering a video of the list
+bool MainWindow::eventFilter(QObject *watched, QEvent *event){
+
+    if (watched != ui->videoList->viewport()) return QMainWindow::eventFilter(watched, event);
+
+    if (event->type() == QEvent::Leave){
+        spritePreview->hide();
+    }
+
+    if (event->type() != QEvent::MouseMove && event->type() != QEvent::ToolTip){
+        return QMainWindow::eventFilter(watched, event);
+    }
+
+    QPoint pos = (event->type() == QEvent::MouseMove
+                      ? static_cast<QMouseEvent*>(event)->position().toPoint()
+                      : static_cast<QHelpEvent*>(event)->pos());
+
+    QListWidgetItem *item = ui->videoList->itemAt(pos);
+    QString spritePath = (item ? item->data(SpriteRole).toString() : "");
+
+    //No sprite yet, the thumbnail tooltip is used instead
+    if (spritePath == ""){
+        spritePreview->hide();
+        return QMainWindow::eventFilter(watched, event);
+    }
+
+    QPixmap sprite;
+    if (!QPixmapCache::find(spritePath, &sprite)){
+        sprite.load(spritePath);
+        QPixmapCache::insert(spritePath, sprite);
+    }
+
+    if (sprite.isNull()){
+        spritePreview->hide();
+        return QMainWindow::eventFilter(watched, event);
+    }
+
+    //The position of the mouse on the row gives the frame, left = start of the video, right = end
+    QRect rect = ui->videoList->visualItemRect(item);
+    int frameWidth = sprite.width() / spriteFrameCount;
+    int frame = qBound(0, (pos.x() - rect.left()) * spriteFrameCount / qMax(1, rect.width()), spriteFrameCount - 1);
+
+    spritePreview->setPixmap(sprite.copy(frame * frameWidth, 0, frameWidth, sprite.height())
+                                 .scaledToWidth(320, Qt::SmoothTransformation));
+    spritePreview->adjustSize();
+    spritePreview->move(ui->videoList->viewport()->mapToGlobal(pos) + QPoint(16, 16));
+    spritePreview->show();
+
+    //The sprite replaces the thumbnail tooltip
+    if (event->type() == QEvent::ToolTip) return true;
+
+    return QMainWindow::eventFilter(watched, event);
+}
+
+//Sets the part of the selected videos that will be compressed, an empty range removes the trim
+void MainWindow::on_actionSetTrimRange_triggered()
+{
+    QList<QListWidgetItem*> items = ui->videoList->selectedItems();
+
+    if (items.isEmpty()){
+        currentLog.overrideMessage = "Select the videos to trim first !";
+        updateInfo();
+        return;
+    }
+
+    bool ok = false;
+    QString range = QInputDialog::getText(
+        this,
+        "Trim Range",
+        "Start-End of the part to compress (ex: 01:30-02:00), leave the end empty to go until the end of the video\n"
+        "Leave empty to compress the whole video",
+        QLineEdit::Normal,
+        "",
+        &ok
+        ).trimmed();
+
+    if (!ok) return;
+
+    double start = 0;
+    double end = 0;
+
+    if (range != ""){
+        QStringList bounds = range.split('-');
+        start = parseTimestamp(bounds.at(0));
+        end = (bounds.size() >= 2 && bounds.at(1).trimmed() != "" ? parseTimestamp(bounds.at(1)) : 0);
+
+        if (bounds.size() > 2 || start < 0 || end < 0 || (end > 0 && end <= start)){
+            currentLog.overrideMessage = "Invalid trim range : " + range;
+            updateInfo();
+            return;
+        }
+    }
+
+    for (QListWidgetItem *item : items){
+        item->setData(TrimStartRole, start);
+        item->setData(TrimEndRole, end);
+        refreshItemText(item);
+    }
+}
 
-        //FFMPEG command to generate the thumbnail
-        QStringList args = {
-            "-y",
-            "-i", filePath,
-            "-ss", "00:00:01",
-            "-vframes", "1",
-            tempThumbnailPath
-        };
+//Shows the name of the video with its trim range and if it's a near-duplicate
+void MainWindow::refreshItemText(QListWidgetItem *item){
+    QString name = QFileInfo(item->data(Qt::UserRole).toString()).fileName();
 
-        process->start(ffmpegPath, args);
+    double start = item->data(TrimStartRole).toDouble();
+    double end = item->data(TrimEndRole).toDouble();
+    if (start > 0 || end > 0){
+        name += " [" + formatTimestamp(start) + " - " + (end > 0 ? formatTimestamp(end) : "end") + "]";
+    }
 
+    QString original = item->data(DuplicateOfRole).toString();
+    if (original != ""){
+        name += " (duplicate of " + QFileInfo(original).fileName() + ")";
     }
+
+    item->setText(name);
+    item->setForeground(original != "" ? QBrush(Qt::gray) : QBrush());
 }
 
+//Flags the video if it looks like one already in the list, otherwise it becomes an original others can match
+void MainWindow::checkDuplicate(QListWidgetItem *item){
+    QString filePath = item->data(Qt::UserRole).toString();
+    if (!videoHashes.contains(filePath)) return;
+
+    VideoHash hash = videoHashes.value(filePath);
+    QString original = duplicateIndex.findDuplicate(hash);
+
+    if (original == ""){
+        duplicateIndex.add(filePath, hash);
+    }
+
+    item->setData(DuplicateOfRole, original);
+    refreshItemText(item);
+}
+
+//Leaves the near-duplicates out of the compression, or not
+void MainWindow::on_actionSkipDuplicates_toggled(bool checked)
+{
+    QSettings settings;
+    skipDuplicates = checked;
+    settings.setValue("skipDuplicates", checked);
+}
+
+//Sets the encoder used for the selected videos, overriding the one of the Encoder menu
+void MainWindow::on_actionSetEncoder_triggered()
+{
+    QList<QListWidgetItem*> items = ui->videoList->selectedItems();
+
+    if (items.isEmpty()){
+        currentLog.overrideMessage = "Select the videos first !";
+        updateInfo();
+        return;
+    }
+
+    QString defaultLabel = "Default (Encoder menu)";
+    QStringList labels = { defaultLabel };
+    for (const EncoderBackend *backend : EncoderBackend::all()){
+        labels << backend->label();
+    }
+
+    bool ok = false;
+    QString chosen = QInputDialog::getItem(this, "Encoder", "Encoder of the selected videos", labels, 0, false, &ok);
+
+    if (!ok) return;
+
+    QString encoderId = "";
+    for (const EncoderBackend *backend : EncoderBackend::all()){
+        if (backend->label() == chosen) encoderId = backend->id();
+    }
+
+    for (QListWidgetItem *item : items){
+        item->setData(EncoderRole, encoderId);
+        item->setStatusTip(chosen == defaultLabel ? "" : "Encoder : " + chosen);
+    }
+}
+
+//Crops the black bars of the videos, or not
+void MainWindow::on_actionDetectCrop_toggled(bool checked)
+{
+    QSettings settings;
+    detectCrop = checked;
+    settings.setValue("detectCrop", checked);
+}
+
+//Drops the static frames of the videos, or not
+void MainWindow::on_actionDecimate_toggled(bool checked)
+{
+    QSettings settings;
+    decimate = checked;
+    settings.setValue("decimate", checked);
+}
+
+//Splits the videos too long for the size limit into parts, or not
+void MainWindow::on_actionSplitIntoParts_toggled(bool checked)
+{
+    QSettings settings;
+    splitIntoParts = checked;
+    settings.setValue("splitIntoParts", checked);
+}
+
+//Uses the size limit for the whole list instead of each video, or not
+void MainWindow::on_actionShareSize_toggled(bool checked)
+{
+    QSettings settings;
+    shareSize = checked;
+    settings.setValue("shareSize", checked);
+}
+
+//Sets the time available for the whole list, the engine then picks the presets and fps to be done in time
+void MainWindow::on_actionSetDeadline_triggered()
+{
+    bool ok = false;
+    QString text = QInputDialog::getText(this, "Deadline",
+                                         "Time available to compress the whole list (hh:mm:ss), empty = no deadline",
+                                         QLineEdit::Normal,
+                                         deadlineSeconds > 0 ? formatTimestamp(deadlineSeconds) : "",
+                                         &ok);
+    if (!ok) return;
+
+    if (text.trimmed() == ""){
+        deadlineSeconds = 0;
+        return;
+    }
+
+    double seconds = parseTimestamp(text);
+    if (seconds <= 0){
+        currentLog.overrideMessage = "Invalid deadline, use hh:mm:ss !";
+        updateInfo();
+        return;
+    }
+
+    deadlineSeconds = seconds;
+}
+
+//Sets several sizes for every video, each size gets its own output but they all share the same decoding and pass 1
+void MainWindow::on_actionSetSizeTiers_triggered()
+{
+    QStringList current;
+    for (double tier : sizeTiers) current << QString::number(tier);
+
+    bool ok = false;
+    QString text = QInputDialog::getText(this, "Size Tiers",
+                                         "Sizes of the outputs of every video, in the unit of the size limit (ex : 8, 25, 50)\nEmpty = only the size limit",
+                                         QLineEdit::Normal,
+                                         current.join(", "),
+                                         &ok);
+    if (!ok) return;
+
+    QList<double> tiers;
+    QStringList saved;
+    for (const QString &part : text.split(',', Qt::SkipEmptyParts)){
+        bool valid = false;
+        double tier = part.trimmed().toDouble(&valid);
+
+        if (!valid || tier <= 0){
+            currentLog.overrideMessage = "Invalid size tier : " + part.trimmed() + " !";
+            updateInfo();
+            return;
+        }
+
+        if (tiers.contains(tier)) continue;
+        tiers << tier;
+        saved << QString::number(tier);
+    }
+
+    sizeTiers = tiers;
+
+    QSettings settings;
+    settings.setValue("sizeTiers", saved.join(","));
+}
+
+//Changes the encoder used by the videos without their own, from the Encoder menu
+void MainWindow::setDefaultEncoder(QString encoderId){
+    QSettings settings;
+    defaultEncoder = encoderId;
+    settings.setValue("encoder", encoderId);
+}
+
+//Encodes a few seconds of the selected video with the current settings and shows them next to the source
+void MainWindow::on_actionPreviewEncode_triggered()
+{
+    QList<QListWidgetItem*> items = ui->videoList->selectedItems();
+
+    if (items.isEmpty()){
+        currentLog.overrideMessage = "Select the video to preview first !";
+        updateInfo();
+        return;
+    }
+
+    if (ffmpegPath == "" || ffprobePath == ""){
+        currentLog.overrideMessage = "Can't detect a valid ffmpeg or ffprobe instance, check the settings to set them !";
+        updateInfo();
+        return;
+    }
+
+    ui->actionPreviewEncode->setEnabled(false);
+
+    PreviewEncoder *preview = new PreviewEncoder(makeJob(items.first()), ffmpegPath, ffprobePath, this);
+    QString fileName = QFileInfo(preview->job().inputPath).fileName();
+
+    connect(preview, &PreviewEncoder::stepChanged, this, [=](QString step){
+        currentLog.overrideMessage = "Preview of " + fileName + "\n" + step;
+        updateInfo();
+    });
+
+    connect(preview, &PreviewEncoder::failed, this, [=](QString error){
+        currentLog.overrideMessage = "Preview failed\n" + error;
+        updateInfo();
+        ui->actionPreviewEncode->setEnabled(true);
+        preview->deleteLater();
+    });
+
+    connect(preview, &PreviewEncoder::finished, this, [=](QStringList images){
+        currentLog.overrideMessage = "Preview of " + fileName + " done !";
+        updateInfo();
+        ui->actionPreviewEncode->setEnabled(true);
+
+        const VideoJob &job = preview->job();
+        QString folder = preview->outputFolder();
+
+        QDialog *dialog = new QDialog(this);
+        dialog->setAttribute(Qt::WA_DeleteOnClose);
+        dialog->setWindowTitle("Preview - " + fileName);
+
+        QVBoxLayout *layout = new QVBoxLayout(dialog);
+        layout->addWidget(new QLabel(
+            "Source (left) / Compressed (right)\n"
+            "Video bitrate : " + QString::number(job.videoInfo.videoBitrateKbps) + " kbps"
+            + " - FPS : " + QString::number(job.videoInfo.fps)
+            + (job.isDecimated() ? " (static frames dropped, ~" + QString::number(job.effectiveFps(), 'f', 1) + " fps)" : "")
+            + " - Size : " + QString::number(job.outputWidth()) + "x" + QString::number(job.outputHeight())
+            + " - Encoder : " + EncoderBackend::byId(job.encoder)->label(),
+            dialog));
+
+        for (const QString &image : images){
+            QLabel *label = new QLabel(dialog);
+            label->setPixmap(QPixmap(image).scaledToWidth(720, Qt::SmoothTransformation));
+            layout->addWidget(label);
+        }
+
+        //The encoded parts can be watched to check the motion too
+        QPushButton *openFolder = new QPushButton("Open the compressed parts", dialog);
+        connect(openFolder, &QPushButton::pressed, dialog, [=](){
+            QDesktopServices::openUrl(QUrl::fromLocalFile(folder));
+        });
+        layout->addWidget(openFolder);
+
+        dialog->show();
+        preview->deleteLater();
+    });
+
+    preview->start();
+}
 
 //Removes the selected items of the list
 void MainWindow::on_button_removeSelectedVideo_pressed()
 {
+    bool hashesRemoved = false;
+
     for(const QListWidgetItem *item : ui->videoList->selectedItems()){
+        QString filePath = item->data(Qt::UserRole).toString();
+        videoItems.remove(filePath);
+        hashesRemoved |= (videoHashes.remove(filePath) > 0);
         delete ui->videoList->takeItem(ui->videoList->row(item));
     }
+
+    //An original could have been removed, the duplicates are found again in the order of the list
+    if (hashesRemoved){
+        duplicateIndex.clear();
+        for (int i = 0 ; i < ui->videoList->count(); i ++){
+            checkDuplicate(ui->videoList->item(i));
+        }
+    }
 }
 
 //select the output folder
@@ -325,7 +1011,9 @@ void MainWindow::updateInfo(){
               + "\nFile Name : "+c.fileName
               +"\n File "+c.fileIndex + "/"+c.fileCount
               + "\nCurrent Step : "+c.step
-              + "\nTarget Size : "+c.targetSize;
+              + "\nEncoder : "+c.encoder
+              + "\nTarget Size : "+c.targetSize
+              + (c.plan != "" ? "\nPlan : "+c.plan : "");
 
     }else{
         txt = c.overrideMessage;
@@ -339,64 +1027,17 @@ void MainWindow::updateInfo(){
 
     //Updating progress bar, god help me
     //This gets the progress, dividing each actions
-    int passNumber = (c.step == "Pass 2" ? 2 : 1);
     int totalFiles = c.fileCount.toInt();
+    if (totalFiles <= 0 || c.passCount <= 0) return;
 
     int fileIndex0 = c.fileIndex.toInt() - 1;
 
-    double stepValue = 100.0 / (totalFiles * 2);
-
-    double progress = (fileIndex0 * 2 + (passNumber - 1)) * stepValue;
-
-    //Adding the local progress to the progress
-
-    if (videoJobs.isEmpty())return;
-
-    //Then adds to the progress the relative progress of the current task
+    double stepValue = 100.0 / (totalFiles * c.passCount);
 
-    VideoJob currentJob = CurrentVJ();
+    double progress = (fileIndex0 * c.passCount + qMax(0, c.pass - 1)) * stepValue;
 
-    float totalVideoDuration =  currentJob.videoInfo.duration; // in seconds
-    QString ffmpegOutput = c.ffmpegOutput;
-    // frame=  123 fps= 60 q=28.0 size=    1024kB time=00:00:05.12 bitrate=1638.4kbits/s speed=1.00x
-
-    //Checks if it succesfully retrieved the time from the ffmpeg output
-    bool gotTime = false;
-
-    float relativeProgress = 0;
-
-    QStringList indexes = ffmpegOutput.split("time=");
-
-    //Gets the time value from the output, ex time=00:00:05.12
-    if (ffmpegOutput.startsWith("frame") && indexes.count() >= 2){
-        ffmpegOutput =  indexes[1];
-        QStringList spaceIndexes = ffmpegOutput.split(" ");
-        if (spaceIndexes.count() >= 1){
-            ffmpegOutput = spaceIndexes[0];
-            gotTime = true;
-        }
-    }
-    //Splits every values from time=00:00:05.12 and converts all to seconds
-    if (gotTime){
-        QStringList parts = ffmpegOutput.split(':');
-        if (parts.size() == 3){
-
-            int hour = parts[0].toInt();
-            int minutes = parts[1].toInt();
-            double seconds = parts[2].toDouble();
-
-            seconds += minutes* 60 + hour * 3600;
-            if (seconds > 2){ // to prevent false positives
-
-                //Calculates the relative progress, from the current time of the video and the total duration
-                float mult = 100/totalVideoDuration;
-                double diff = (seconds*mult) / (totalVideoDuration*mult);
-
-                //Adds the calculated relative progress
-                relativeProgress = (diff * 100) / (c.fileCount.toInt() * 2);
-            }
-        }
-    }
+    //Then adds to the progress the relative progress of the current pass, sent by the engine
+    double relativeProgress = (c.pass > 0 ? c.passProgress * stepValue : 0);
 
     //Adds the relative progress
     int totalProgress = progress + relativeProgress;
@@ -478,29 +1119,15 @@ void MainWindow::on_pushButton_compress_pressed()
         return;
     }
 
-    QDir outputFolder(ui->lineEdit_outputFolder->text());
-    if (ui->lineEdit_outputFolder->text() == "" || !outputFolder.exists()){
-        currentLog.overrideMessage = "The output folder is invalid !";
-        updateInfo();
-        return;
-    }
-
-    if (ui->doubleSpinBox_finalSize->value() <= 0){
-        currentLog.overrideMessage = "You must set a valid fps limit !";
-        updateInfo();
-        return;
-    }
+    if (!checkOutputSettings()) return;
 
-    if (ffmpegPath == "" || ffprobePath == ""){
-        currentLog.overrideMessage = "Can't detect a valid ffmpeg or ffprobe instance, check the settings to set them !";
-        updateInfo();
-        return;
-    }
+    QDir outputFolder(ui->lineEdit_outputFolder->text());
 
     //Resets dynamic variables
     oldProgress = 0;
     abortPressed = false;
-    videoJobs.clear();
+    QList<VideoJob> videoJobs;
+    QSet<QString> usedOutputNames;
 
     currentLog.overrideMessage = "Preparing videos...";
     updateInfo();
@@ -509,198 +1136,203 @@ void MainWindow::on_pushButton_compress_pressed()
     for (int i = 0 ; i < ui->videoList->count(); i ++){
         QListWidgetItem *item = ui->videoList->item(i);
 
+        //Same video as another one of the list, no need to compress it twice
+        if (skipDuplicates && item->data(DuplicateOfRole).toString() != ""){
+            continue;
+        }
+
         QString filePath = item->data(Qt::ItemDataRole::UserRole).toString();
-        QString fileName = QFileInfo(filePath).fileName();
 
-        //Check if no output path is the same
-        bool isTheSame = false;
-        for(int j = 0; j < videoJobs.count() ; j++){
-            if (videoJobs.at(j).outputPath.endsWith(fileName)){
-                isTheSame = true;
+        VideoJob videoJob = makeJob(item);
+
+        //With size tiers, each output also gets its size in its name, ex : clip_8MB.mp4
+        //A size shared by the whole list has no tiers, the size of each video depends on the others
+        QList<double> tiers = (shareSize ? QList<double>() : sizeTiers);
+        QStringList tierSuffixes = { "" };
+        if (!tiers.isEmpty()){
+            tierSuffixes.clear();
+            for (double tier : tiers){
+                tierSuffixes << "_" + QString::number(tier) + ui->comboBox_finalSizeType->currentText();
             }
         }
 
-        VideoJob videoJob;
-        videoJob.inputPath = filePath;
+        //The output keeps the name of the video, with the extension of the container of the encoder
+        QString baseName = QFileInfo(filePath).completeBaseName();
+        QString extension = "." + EncoderBackend::byId(videoJob.encoder)->containerExtension();
+        QString outputName = baseName + tierSuffixes.first() + extension;
+
+        //Check if no output path is the same, a set since the list can have thousands of videos
+        bool isTheSame = usedOutputNames.contains(outputName);
 
         //If outputPath is the same, add i at the end of the name of the file
         // ex : clip.mp4 => clip1.mp4, or clip2.mp4
-        QString outputPath;
         if (isTheSame){
-            QString temp = QFileInfo(videoJob.inputPath).fileName();
-            temp.chop(4);
-            temp += QString::number(i) + ".mp4";
-            outputPath = outputFolder.absolutePath() + "/" +  temp;
-        }else{
-            outputPath = outputFolder.absolutePath() + "/" + QFileInfo(videoJob.inputPath).fileName();
+            baseName += QString::number(i);
         }
 
-        videoJob.outputPath = outputPath;
-        videoJobs.append(videoJob);
-    }
-
-    totalVideosCompressing = videoJobs.count();
-    currentLog.fileCount = QString::number(videoJobs.count());
+        videoJob.outputPath = outputFolder.absolutePath() + "/" + baseName + tierSuffixes.first() + extension;
+        usedOutputNames.insert(baseName + tierSuffixes.first() + extension);
 
-    //Starts the Pass1
-    job1StartLoop();
-}
+        //The first tier is the main output, the others are encoded by the same pass 2
+        for (int k = 0; k < tiers.count(); k++){
+            if (k == 0){
+                videoJob.targetBits = sizeToBits(tiers.at(k));
+                continue;
+            }
 
+            VideoTarget target;
+            target.targetBits = sizeToBits(tiers.at(k));
+            target.outputPath = outputFolder.absolutePath() + "/" + baseName + tierSuffixes.at(k) + extension;
+            videoJob.extraTargets.append(target);
+        }
 
-// Starts or continue the loop of compression for all videos
-void MainWindow::job1StartLoop(){
+        videoJobs.append(videoJob);
+    }
 
-    //This function is called in a loop until no video is left
     if (videoJobs.isEmpty()){
-        currentLog.overrideMessage = "Succesfully compressed all of the files !";
+        currentLog.overrideMessage = "Every video is a near-duplicate of another one !";
         updateInfo();
-        ui->progressBar->setValue(100);
         return;
     }
 
-    job2GetVideoData();
+    currentLog.fileCount = QString::number(videoJobs.count());
+    currentLog.fileIndex = "";
+    currentLog.pass = 0;
+    currentLog.plan = "";
+    currentLog.targetSize = QString::number(ui->doubleSpinBox_finalSize->value() ) + ui->comboBox_finalSizeType->currentText();
 
-}
+    if (shareSize){
+        currentLog.targetSize += " for the whole list";
+    }else if (!sizeTiers.isEmpty()){
+        QStringList tiers;
+        for (double tier : sizeTiers) tiers << QString::number(tier);
+        currentLog.targetSize = tiers.join(", ") + ui->comboBox_finalSizeType->currentText();
+    }
 
-//Starts by retrieving all video data using ffprobe, such as framerate, duration, width + height, etc
-void MainWindow::job2GetVideoData(){
+    //Gives the jobs to the engine, in its thread
+    QString ffmpeg = ffmpegPath;
+    QString ffprobe = ffprobePath;
 
-    QProcess *ffprobe = new QProcess(this);
+    //The deadline starts when the compression starts
+    QDateTime deadline = (deadlineSeconds > 0 ? QDateTime::currentDateTime().addMSecs(deadlineSeconds * 1000) : QDateTime());
 
-    //this part is called after the original command has been executed
-    connect(ffprobe, &QProcess::finished, this, [=](int exitCode, QProcess::ExitStatus){
-        qDebug() << "job2 - finished ffprobe with exit code ";
-        qDebug() << exitCode;
-        if (exitCode != 0) {
-            qWarning() << "Error FFMPEG";
-            qWarning () << exitCode;
-            currentLog.overrideMessage = "Error FFMPEG : "+ QString::number(exitCode) + "\n"+ffprobe->readAllStandardError();
-            updateInfo();
-            ffprobe->deleteLater();
-            return;
-        }
+    long long unsigned sharedBits = (shareSize ? targetSizeBits() : 0);
 
-        //Gets the output of the command
-        QByteArray output = ffprobe->readAllStandardOutput();
-        QJsonDocument doc = QJsonDocument::fromJson(output);
+    QMetaObject::invokeMethod(engine, [=](){
+        engine->start(videoJobs, ffmpeg, ffprobe, deadline, sharedBits);
+    });
+}
 
-        //Tries to retrieve the data from the generated json
-        if (doc.isObject()){
-            QJsonObject root = doc.object();
 
-            // Duration
-            if (root.contains("format")) {
-                QJsonObject format = root["format"].toObject();
-                if (format.contains("duration"))
-                    CurrentVJ().videoInfo.duration = format["duration"].toString().toDouble();
-            }
+//Checks the output folder, the size limit and the dependencies before compressing anything
+bool MainWindow::checkOutputSettings(){
+    QDir outputFolder(ui->lineEdit_outputFolder->text());
+    if (ui->lineEdit_outputFolder->text() == "" || !outputFolder.exists()){
+        currentLog.overrideMessage = "The output folder is invalid !";
+        updateInfo();
+        return false;
+    }
 
-            // Video stream
-            if (root.contains("streams")) {
-                QJsonArray streams = root["streams"].toArray();
-                for (const QJsonValue& val : streams) {
-                    QJsonObject stream = val.toObject();
-                    QString codecType = stream["codec_type"].toString();
-                    if (codecType == "video") {
-                        // FPS
-                        QString fpsStr = stream["avg_frame_rate"].toString(); //ex: "30000/1001"
-                        QStringList parts = fpsStr.split('/');
-                        if (parts.size() == 2)
-                            CurrentVJ().videoInfo.fps = parts[0].toDouble() / parts[1].toDouble();
-
-                        CurrentVJ().videoInfo.width = stream["width"].toInt();
-                        CurrentVJ().videoInfo.height = stream["height"].toInt();
-                        break;
-                    }
-                }
-
-                // Audio stream
-                for (const QJsonValue& val : streams) {
-                    QJsonObject stream = val.toObject();
-                    QString codecType = stream["codec_type"].toString();
-                    if (codecType == "audio") {
-                        CurrentVJ().videoInfo.audioBitrateKbps = stream["bit_rate"].toString().toInt() / 1000; //kbps
-                        break;
-                    }
-                }
-            }}
-
-        //here we got the full videoInfo set, we start the job3 - Pass1
-        job3Pass1();
-    });
+    if (ui->doubleSpinBox_finalSize->value() <= 0){
+        currentLog.overrideMessage = "You must set a valid fps limit !";
+        updateInfo();
+        return false;
+    }
 
-    //Resets the log
-    currentLog.overrideMessage = "";
-    currentLog.fileName = QFileInfo(CurrentVJ().inputPath).fileName();
-    currentLog.fileIndex = QString::number(totalVideosCompressing - videoJobs.count() + 1);
-    currentLog.step = "Retrieving video data";
-    currentLog.targetSize = QString::number(ui->doubleSpinBox_finalSize->value() ) + ui->comboBox_finalSizeType->currentText();
-    updateInfo();
+    if (ffmpegPath == "" || ffprobePath == ""){
+        currentLog.overrideMessage = "Can't detect a valid ffmpeg or ffprobe instance, check the settings to set them !";
+        updateInfo();
+        return false;
+    }
 
-    //Sets up the ffprobe command and executes it
-    QStringList args;
-    args << "-v" << "error"
-         << "-show_entries"
-         << "format=duration:stream=index,codec_type,avg_frame_rate,width,height,bit_rate,sample_rate,channels"
-         << "-of" << "json"
-         << CurrentVJ().inputPath;
+    return true;
+}
+
+//Compresses a video while it's still being recorded, the compressed file is ready a few seconds after the recording stops
+//The recording must be readable while it's written (mkv, ts, flv or fragmented mp4, not a regular mp4)
+void MainWindow::on_actionCompressLive_triggered()
+{
+    QSettings settings;
+    settings.setValue("sizeLimit",ui->doubleSpinBox_finalSize->value());
+    settings.setValue("sizeLimitType",ui->comboBox_finalSizeType->currentIndex());
+    currentLog.overrideMessage = "";
 
-    ffprobe->start(ffprobePath, args);
+    if (!checkOutputSettings()) return;
 
-}
+    QString filePath = QFileDialog::getOpenFileName(
+        this,
+        "Select the recording",
+        QDir(defaultVideoFolder).exists() ? defaultVideoFolder : QDir::homePath(),
+        "Recordings (*.mkv *.ts *.flv *.mp4)"
+        );
 
-//Starts the Pass1 of the compression, after getting all of the video data
-//Pass 1 = Scanning the file and making a file with all of the data
-void MainWindow::job3Pass1(){
-    currentLog.step = "Pass 1";
-    updateInfo();
+    if (filePath == "") return;
 
-    QProcess *ffmpegPass1 = new QProcess(this);
+    bool ok = false;
+    QString expected = QInputDialog::getText(this, "Live Compression",
+                                             "Expected length of the recording (hh:mm:ss), the bitrate is planned from it until the recording stops",
+                                             QLineEdit::Normal, "00:30:00", &ok);
+    if (!ok) return;
 
-    //Called after the original command has been executed and when an update is sent by ffmpeg
-    //in order to update the progress bar
-    connect(ffmpegPass1, &QProcess::readyReadStandardError, this, [=](){
-        if (abortPressed){
-            ffmpegPass1->deleteLater();
-            updateInfo();
-            return;
-        }
-        currentLog.ffmpegOutput = ffmpegPass1->readAllStandardError();
+    double expectedDuration = parseTimestamp(expected);
+    if (expectedDuration <= 0){
+        currentLog.overrideMessage = "Invalid length, use hh:mm:ss !";
         updateInfo();
-    });
+        return;
+    }
 
-    //Called once the command has been executed and completed, so that it starts the job4 - Pass2
-    connect(ffmpegPass1, &QProcess::finished, this, [=](int exitCode, QProcess::ExitStatus){
-        qDebug() << "finished ffprobe with exit code";
-        qDebug() << exitCode;
-        if (exitCode != 0) {
-            qWarning() << "Error FFMPEG";
-            qWarning() << exitCode;
-            currentLog.overrideMessage = "Error FFMPEG : "+ QString::number(exitCode) + "\n"+ffmpegPass1->readAllStandardError();
-            updateInfo();
-            ffmpegPass1->deleteLater();
-            return;
-        }
+    VideoJob videoJob;
+    videoJob.inputPath = filePath;
+    videoJob.encoder = defaultEncoder;
+    videoJob.targetBits = targetSizeBits();
+    videoJob.fpsLimit = outputFpsLimit();
+    videoJob.outputPath = QDir(ui->lineEdit_outputFolder->text()).absolutePath() + "/"
+                          + QFileInfo(filePath).completeBaseName() + "." + EncoderBackend::byId(videoJob.encoder)->containerExtension();
 
-        job3Pass2();
-        //Pass2 !!
-    });
+    oldProgress = 0;
+    abortPressed = false;
+    currentLog.fileCount = "1";
+    currentLog.fileIndex = "";
+    currentLog.pass = 0;
+    currentLog.plan = "";
+    currentLog.targetSize = QString::number(ui->doubleSpinBox_finalSize->value() ) + ui->comboBox_finalSizeType->currentText();
 
+    QString ffmpeg = ffmpegPath;
+    QString ffprobe = ffprobePath;
+    QMetaObject::invokeMethod(engine, [=](){
+        engine->startLive(videoJob, ffmpeg, ffprobe, expectedDuration);
+    });
+}
 
-    //QStandardPaths::writableLocation(QStandardPaths::CacheLocation) + "/tempffmpeg/"
+//Creates the job of a video of the list with the current settings, without its output path
+VideoJob MainWindow::makeJob(QListWidgetItem *item){
+    VideoJob videoJob;
+    videoJob.inputPath = item->data(Qt::ItemDataRole::UserRole).toString();
+    videoJob.trimStart = item->data(TrimStartRole).toDouble();
+    videoJob.trimEnd = item->data(TrimEndRole).toDouble();
+
+    QString itemEncoder = item->data(EncoderRole).toString();
+    videoJob.encoder = (itemEncoder != "" ? itemEncoder : defaultEncoder);
+    videoJob.targetBits = targetSizeBits();
+    videoJob.fpsLimit = outputFpsLimit();
+    videoJob.splitIntoParts = splitIntoParts;
+    videoJob.detectCrop = detectCrop;
+    videoJob.decimate = decimate;
+
+    return videoJob;
+}
 
-    //Making the Pass1
-    //Maths to get the final video bitrate + other stuff kms
+//Converts the size limit of the ui to bits
+long long unsigned MainWindow::targetSizeBits(){
+    return sizeToBits(ui->doubleSpinBox_finalSize->value());
+}
 
-    //Sets the path for the pass1 log, in the cache folder of cutie
-    QString passlogPath = QStandardPaths::writableLocation(QStandardPaths::CacheLocation) + "/tempffmpeg/ffmpeg_pass-0.log";
-    QDir().mkpath(passlogPath);
+//Converts a size in the unit of the size limit of the ui to bits
+long long unsigned MainWindow::sizeToBits(double size){
 
     //Pretty sure it can handle any type of number, even for realle huge sizes lol
-    long long unsigned targetBitSize;
-    long long unsigned videoBitratebps;
+    long long unsigned targetBitSize = 0;
 
-    double size = ui->doubleSpinBox_finalSize->value();
     QString type = ui->comboBox_finalSizeType->currentText();
 
     //Sorry abaienst but not switch for QString ? pretty sure it doesn't change anything once compiled
@@ -723,97 +1355,12 @@ void MainWindow::job3Pass1(){
         targetBitSize = size * 1000000000 * 8;
     }
 
-    //Calculating the video bitratebps in order to re encode the video with this limit of bits for the video
-    //While keeping the audio untouched
-
-    long long unsigned video_bits = targetBitSize - (CurrentVJ().videoInfo.audioBitrateKbps * 1000 * CurrentVJ().videoInfo.duration);
-    videoBitratebps = video_bits/CurrentVJ().videoInfo.duration;
-
-    long long unsigned video_bitrate_kbps = std::roundl(videoBitratebps / 1000);
-    CurrentVJ().videoInfo.videoBitrateKbps = video_bitrate_kbps;
-
-    double targetFPS = CurrentVJ().videoInfo.fps;
-
-    //if we needs to reencode with custom output fps
-    if (ui->spinBox_outputFPS->isEnabled() && ui->spinBox_outputFPS->value() < targetFPS){
-        targetFPS = ui->spinBox_outputFPS->value();
-        CurrentVJ().videoInfo.fps = targetFPS;
-    }
-
-    //Sets up the ffmpeg command and executes it
-    QStringList args;
-    args << "-y" << "-i" << CurrentVJ().inputPath
-         << "-r" << QString::number(targetFPS) << "-c:v" << "libx264"
-         << "-b:v" <<  QString::number(video_bitrate_kbps)+"k"
-         << "-pass"<<"1"<< "-passlogfile" <<passlogPath << "-an"
-         << "-f"<<"null"<< "NUL";
-
-    ffmpegPass1->start(ffmpegPath, args);
-}
-
-//job3 - Pass2 !!
-//Reencode the video with the calculated bitrate for the video, custom fps if any, and data from the
-//generated passlog of ffmpeg
-void MainWindow::job3Pass2(){
-    currentLog.step = "Pass 2";
-
-    QProcess *ffmpegPass2 = new QProcess(this);
-
-    connect(ffmpegPass2, &QProcess::readyReadStandardError, this, [=](){
-        if (abortPressed){
-            ffmpegPass2->deleteLater();
-            updateInfo();
-            return;
-        }
-        currentLog.ffmpegOutput = ffmpegPass2->readAllStandardError();
-        updateInfo();
-    });
-
-    connect(ffmpegPass2, &QProcess::finished, this, [=](int exitCode, QProcess::ExitStatus){
-        qDebug() << "finished ffmpegPass2 with exit code";
-        qDebug() << exitCode;
-        if (exitCode != 0) {
-            qWarning() << "Error FFMPEG";
-            qWarning() << exitCode;
-            currentLog.overrideMessage = "Error FFMPEG : "+ QString::number(exitCode) + "\n"+ffmpegPass2->readAllStandardError();
-            updateInfo();
-            ffmpegPass2->deleteLater();
-            return;
-        }
-        //Because the compression is done, removes the video from the "queue"
-        //just a list lol kill me pardon
-
-        videoJobs.takeFirst();
-
-        //Restarts the loop
-        job1StartLoop();
-    });
-
-
-    //Retrieves the generated passlog from ffmpeg to use it in the args
-    QString passlogPath = QStandardPaths::writableLocation(QStandardPaths::CacheLocation) + "/tempffmpeg/ffmpeg_pass-0.log";
-
-    //Generates the ffmpeg args with the data
-    //it took way too much times to do and debug, worst thing ever 10/10
-
-    QStringList args;
-    args << "-y" << "-i" << CurrentVJ().inputPath
-         << "-r" << QString::number(CurrentVJ().videoInfo.fps)
-         <<"-c:v" <<"libx264" <<"-b:v"
-         << QString::number(CurrentVJ().videoInfo.videoBitrateKbps)+"k"
-         << "-pass" << "2" << "-passlogfile" << passlogPath<< "-c:a"
-         <<"aac"<<"-b:a" << QString::number(CurrentVJ().videoInfo.audioBitrateKbps) + "k"
-         << "-preset" <<"slow"<<"-profile:v"<<"high"
-         <<"-level"<<"4.2" << CurrentVJ().outputPath;
-
-    ffmpegPass2->start(ffmpegPath, args);
+    return targetBitSize;
 }
 
-//To get the current VideoJob, couldn't correctly gives the same stuct through
-//the different functions while changing its data due to skill issue
-//TEMP
-VideoJob& MainWindow::CurrentVJ(){
-    return videoJobs[0];
+//Max fps of the output from the ui, 0 if the fps is not changed
+int MainWindow::outputFpsLimit(){
+    return ui->spinBox_outputFPS->isEnabled() ? ui->spinBox_outputFPS->value() : 0;
 }
 
 //to abort the whole thing
@@ -822,6 +1369,9 @@ void MainWindow::on_pushButton_abort_pressed()
     abortPressed = true;
     oldProgress = 0;
     ui->progressBar->setValue(0);
+    updateInfo();
+
+    QMetaObject::invokeMethod(engine, &CompressionEngine::abort);
 }
 
 //To clear the output folder when new files are being compressed
@@ -896,15 +1446,31 @@ void MainWindow::refreshDependencies(){
     bool ffmpegGlobal = false;
     bool ffprobeGlobal = false;
 
+    //Paths forced by the environment, ex : a stand-in ffmpeg to run huge queues without encoding anything
+    QString ffmpegOverride = qEnvironmentVariable("GVC_FFMPEG");
+    QString ffprobeOverride = qEnvironmentVariable("GVC_FFPROBE");
+    bool ffmpegForced = (ffmpegOverride != "" && testProcess(ffmpegOverride));
+    bool ffprobeForced = (ffprobeOverride != "" && testProcess(ffprobeOverride));
+
+    if (ffmpegForced){
+        ffmpegLocal = false;
+        ffmpegPath = ffmpegOverride;
+    }
+
+    if (ffprobeForced){
+        ffprobeLocal = false;
+        ffprobePath = ffprobeOverride;
+    }
+
     // if not detected locally, try to load the globally
-    if (!ffmpegLocal){
+    if (!ffmpegLocal && !ffmpegForced){
         if (testProcess("ffmpeg")){
             ffmpegGlobal = true;
             ffmpegPath = "ffmpeg";
         }
     }
 
-    if (!ffprobeLocal){
+    if (!ffprobeLocal && !ffprobeForced){
         if (testProcess("ffprobe")){
             ffprobeGlobal = true;
             ffprobePath = "ffprobe";
@@ -915,13 +1481,17 @@ void MainWindow::refreshDependencies(){
     QString ffmpegButtonLabel = "FFMPEG is not detected !";
     QString ffprobeButtonLabel = "FFPROBE is not detected !";
 
-    if (ffmpegLocal){
+    if (ffmpegForced){
+        ffmpegButtonLabel = "FFMPEG is detected !\n(GVC_FFMPEG)";
+    }else if (ffmpegLocal){
         ffmpegButtonLabel = "FFMPEG is detected !\n(locally)";
     }else if (ffmpegGlobal){
         ffmpegButtonLabel = "FFMPEG is detected !\n(globally)";
     }
 
-    if (ffprobeLocal){
+    if (ffprobeForced){
+        ffprobeButtonLabel = "FFPROBE is detected !\n(GVC_FFPROBE)";
+    }else if (ffprobeLocal){
         ffprobeButtonLabel = "FFPROBE is detected !\n(locally)";
     }else if (ffprobeGlobal){
         ffprobeButtonLabel = "FFPROBE is detected !\n(globally)";
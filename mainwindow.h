@@ -18,12 +18,45 @@ public:
     MainWindow(QWidget *parent = nullptr);
     ~MainWindow();
 
+protected:
+    bool eventFilter(QObject *watched, QEvent *event) override;
+
 private slots:
 
     void on_button_AddVideos_pressed();
 
+    void on_actionAddFolder_triggered();
+
+    bool addVideo(const QString &filePath);
+
     void on_button_removeSelectedVideo_pressed();
 
+    void generateSprite(QString filePath, QString spritePath);
+
+    void on_actionSetTrimRange_triggered();
+
+    void refreshItemText(QListWidgetItem *item);
+
+    void checkDuplicate(QListWidgetItem *item);
+
+    void on_actionSkipDuplicates_toggled(bool checked);
+
+    void on_actionDetectCrop_toggled(bool checked);
+    void on_actionDecimate_toggled(bool checked);
+
+    void on_actionSplitIntoParts_toggled(bool checked);
+    void on_actionShareSize_toggled(bool checked);
+
+    void on_actionSetDeadline_triggered();
+
+    void on_actionSetSizeTiers_triggered();
+
+    void on_actionSetEncoder_triggered();
+
+    void on_actionPreviewEncode_triggered();
+
+    void setDefaultEncoder(QString encoderId);
+
     void on_toolButton_choseOutputFolder_pressed();
 
     void on_checkBox_outputFPS_pressed();
@@ -34,15 +67,17 @@ private slots:
 
     void updateInfo();
 
-    void job1StartLoop();
+    bool checkOutputSettings();
+
+    void on_actionCompressLive_triggered();
 
-    void job2GetVideoData();
+    VideoJob makeJob(QListWidgetItem *item);
 
-    void job3Pass1();
+    long long unsigned targetSizeBits();
 
-    void job3Pass2();
+    long long unsigned sizeToBits(double size);
 
-    VideoJob& CurrentVJ();
+    int outputFpsLimit();
 
 
     void on_pushButton_abort_pressed();
@@ -0,0 +1,253 @@
+#include "mp4probe.h"
+#include <QFile>
+#include <QtEndian>
+
+//A box of the file : its type and its content, without the header
+struct Mp4Box {
+    quint32 type = 0;
+    const uchar *data = nullptr;
+    quint64 size = 0;
+};
+
+//What is needed of a track to fill the VideoInfo
+struct Mp4Track {
+    quint32 handler = 0;
+    quint32 timescale = 0;
+    quint64 duration = 0;
+
+    //From stts, the sum of the durations of the samples is in the timescale of the track
+    quint64 sampleCount = 0;
+    quint64 samplesDuration = 0;
+
+    //From stsz
+    quint64 bytes = 0;
+
+    int width = 0;
+    int height = 0;
+};
+
+static constexpr quint32 boxType(const char (&name)[5]){
+    return (quint32(uchar(name[0])) << 24) | (quint32(uchar(name[1])) << 16) | (quint32(uchar(name[2])) << 8) | quint32(uchar(name[3]));
+}
+
+static quint16 read16(const uchar *data){
+    return qFromBigEndian<quint16>(data);
+}
+
+static quint32 read32(const uchar *data){
+    return qFromBigEndian<quint32>(data);
+}
+
+static quint64 read64(const uchar *data){
+    return qFromBigEndian<quint64>(data);
+}
+
+//Reads the box at pos and moves pos after it, returns false at the end or if the box doesn't fit in its parent
+static bool nextBox(const uchar *&pos, const uchar *end, Mp4Box &box){
+    if (end - pos < 8) return false;
+
+    quint64 size = read32(pos);
+    quint64 header = 8;
+    box.type = read32(pos + 4);
+
+    if (size == 1){
+        //64 bits size, for the mdat of big files
+        if (end - pos < 16) return false;
+        size = read64(pos + 8);
+        header = 16;
+    }else if (size == 0){
+        //Goes until the end of the parent
+        size = end - pos;
+    }
+
+    if (size < header || size > quint64(end - pos)) return false;
+
+    box.data = pos + header;
+    box.size = size - header;
+    pos += size;
+    return true;
+}
+
+//Finds the first child of the given type
+static bool findBox(const Mp4Box &parent, quint32 type, Mp4Box &box){
+    const uchar *pos = parent.data;
+    const uchar *end = parent.data + parent.size;
+
+    while (nextBox(pos, end, box)){
+        if (box.type == type) return true;
+    }
+    return false;
+}
+
+//Timescale and duration of a mvhd or mdhd (same layout), the version 1 has 64 bits times
+static bool readTimes(const Mp4Box &box, quint32 &timescale, quint64 &duration){
+    if (box.size < 4) return false;
+
+    if (box.data[0] == 1){
+        if (box.size < 32) return false;
+        timescale = read32(box.data + 20);
+        duration = read64(box.data + 24);
+    }else{
+        if (box.size < 20) return false;
+        timescale = read32(box.data + 12);
+        duration = read32(box.data + 16);
+
+        //All ones = unknown duration
+        if (duration == 0xFFFFFFFF) duration = 0;
+    }
+
+    return timescale > 0;
+}
+
+//Display size of the track in 16.16 fixed point, after the matrix
+static void readTrackHeader(const Mp4Box &tkhd, Mp4Track &track){
+    if (tkhd.size < 4) return;
+
+    quint64 offset = (tkhd.data[0] == 1 ? 88 : 76);
+    if (tkhd.size < offset + 8) return;
+
+    track.width = read32(tkhd.data + offset) >> 16;
+    track.height = read32(tkhd.data + offset + 4) >> 16;
+}
+
+static bool readSampleTable(const Mp4Box &stbl, Mp4Track &track){
+    Mp4Box box;
+
+    //Size of the first visual sample entry (avc1, hvc1...), the coded size like ffprobe gives, tkhd can be scaled
+    if (track.handler == boxType("vide") && findBox(stbl, boxType("stsd"), box) && box.size >= 44){
+        int width = read16(box.data + 40);
+        int height = read16(box.data + 42);
+        if (width > 0 && height > 0){
+            track.width = width;
+            track.height = height;
+        }
+    }
+
+    //Time to sample : runs of samples with the same duration
+    if (!findBox(stbl, boxType("stts"), box) || box.size < 8) return false;
+
+    quint64 runs = read32(box.data + 4);
+    if (8 + runs * 8 > box.size) return false;
+
+    for (quint64 i = 0; i < runs; i++){
+        const uchar *run = box.data + 8 + i * 8;
+        quint64 count = read32(run);
+        track.sampleCount += count;
+        track.samplesDuration += count * read32(run + 4);
+    }
+
+    //Sample sizes : one size for every sample, or the size of each of them
+    if (!findBox(stbl, boxType("stsz"), box) || box.size < 12) return false;
+
+    quint64 sampleSize = read32(box.data + 4);
+    quint64 sampleCount = read32(box.data + 8);
+
+    if (sampleSize > 0){
+        track.bytes = sampleSize * sampleCount;
+    }else{
+        if (12 + sampleCount * 4 > box.size) return false;
+
+        for (quint64 i = 0; i < sampleCount; i++){
+            track.bytes += read32(box.data + 12 + i * 4);
+        }
+    }
+
+    return true;
+}
+
+//trak > tkhd, mdia > mdhd, hdlr, minf > stbl
+static bool readTrack(const Mp4Box &trak, Mp4Track &track){
+    Mp4Box box;
+    Mp4Box mdia;
+    Mp4Box minf;
+    Mp4Box stbl;
+
+    if (findBox(trak, boxType("tkhd"), box)) readTrackHeader(box, track);
+
+    if (!findBox(trak, boxType("mdia"), mdia)) return false;
+    if (!findBox(mdia, boxType("mdhd"), box) || !readTimes(box, track.timescale, track.duration)) return false;
+    if (!findBox(mdia, boxType("hdlr"), box) || box.size < 12) return false;
+    track.handler = read32(box.data + 8);
+
+    if (!findBox(mdia, boxType("minf"), minf) || !findBox(minf, boxType("stbl"), stbl)) return false;
+    return readSampleTable(stbl, track);
+}
+
+bool readMp4Info(const QString &inputPath, VideoInfo &info){
+    QFile file(inputPath);
+    if (!file.open(QIODevice::ReadOnly) || file.size() < 16) return false;
+
+    //Only the pages actually read are loaded, the mdat is skipped without being read
+    //Can fail for huge files on 32 bits, ffprobe does the job then
+    const uchar *map = file.map(0, file.size());
+    if (!map) return false;
+
+    Mp4Box root;
+    root.data = map;
+    root.size = file.size();
+
+    //Other containers are not walked through, an MP4 / MOV starts with one of these
+    Mp4Box first;
+    const uchar *pos = map;
+    if (!nextBox(pos, map + file.size(), first)) return false;
+
+    static const QList<quint32> firstBoxes = { boxType("ftyp"), boxType("moov"), boxType("mdat"),
+                                               boxType("wide"), boxType("free"), boxType("skip") };
+    if (!firstBoxes.contains(first.type)) return false;
+
+    Mp4Box moov;
+    Mp4Box box;
+    if (!findBox(root, boxType("moov"), moov)) return false;
+
+    //Fragmented file, the samples are in the moof boxes and the moov only has the first ones
+    if (findBox(moov, boxType("mvex"), box)) return false;
+
+    quint32 movieTimescale = 0;
+    quint64 movieDuration = 0;
+    if (!findBox(moov, boxType("mvhd"), box) || !readTimes(box, movieTimescale, movieDuration)) return false;
+    if (movieDuration == 0) return false;
+
+    //First video and first audio track, like ffprobe picks
+    Mp4Track video;
+    Mp4Track audio;
+    bool videoFound = false;
+    bool audioFound = false;
+
+    pos = moov.data;
+    while (nextBox(pos, moov.data + moov.size, box)){
+        if (box.type != boxType("trak")) continue;
+
+        Mp4Track track;
+        if (!readTrack(box, track)) continue;
+
+        if (!videoFound && track.handler == boxType("vide")){
+            video = track;
+            videoFound = true;
+        }else if (!audioFound && track.handler == boxType("soun")){
+            audio = track;
+            audioFound = true;
+        }
+    }
+
+    if (!videoFound || video.width <= 0 || video.height <= 0 || video.sampleCount == 0 || video.samplesDuration == 0){
+        return false;
+    }
+
+    info.duration = static_cast<double>(movieDuration) / movieTimescale;
+    info.sourceBitrateKbps = file.size() * 8 / info.duration / 1000;
+
+    //Mean fps, same as the avg_frame_rate of ffprobe
+    info.fps = video.sampleCount * static_cast<double>(video.timescale) / video.samplesDuration;
+    info.width = video.width;
+    info.height = video.height;
+
+    info.audioBitrateKbps = 0;
+    if (audioFound){
+        quint64 audioDuration = (audio.duration > 0 ? audio.duration : audio.samplesDuration);
+        if (audioDuration > 0){
+            info.audioBitrateKbps = audio.bytes * 8 / (static_cast<double>(audioDuration) / audio.timescale) / 1000;
+        }
+    }
+
+    return true;
+}
@@ -0,0 +1,14 @@
+#ifndef MP4PROBE_H
+#define MP4PROBE_H
+
+#include <QString>
+#include "videojob.h"
+
+//Reads the VideoInfo of an MP4 / MOV file straight from its boxes, without starting ffprobe
+//The file is memory mapped and only the boxes of the moov are read (mvhd, tkhd, mdhd, hdlr, stsd, stts, stsz),
+//the frames themselves are never touched so it only takes a few pages of the file whatever its size
+//Returns false (and leaves the VideoInfo as it was) if it's not an MP4 / MOV, if the moov is missing
+//(recording still in progress) or if the file is fragmented, ffprobe is then used as usual
+bool readMp4Info(const QString &inputPath, VideoInfo &info);
+
+#endif // MP4PROBE_H
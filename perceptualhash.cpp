@@ -0,0 +1,189 @@
+#include "perceptualhash.h"
+#include <QSet>
+#include <QtAlgorithms>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define PHASH_SSE2
+#include <emmintrin.h>
+#endif
+
+//The frame is reduced to 72x64 pixels, then summed in 9x8 blocks of 8x8 pixels
+static const int blockSize = 8;
+static const int blockColumns = 9;
+static const int blockRows = 8;
+
+//Under this difference between the brightest and the darkest block, the frame is considered flat
+static const int flatThreshold = 4 * blockSize * blockSize;
+
+bool VideoHash::isEmpty() const{
+    return !usable.contains(true);
+}
+
+static_assert(blockRows == 8 && blockColumns == 9, "blockSums is declared with 8x9 sums in the header");
+
+void blockSumsScalar(const QImage &gray, int sums[blockRows][blockColumns]){
+    for (int row = 0; row < blockRows; row++){
+        for (int column = 0; column < blockColumns; column++){
+            sums[row][column] = 0;
+        }
+
+        for (int y = 0; y < blockSize; y++){
+            const uchar *line = gray.constScanLine(row * blockSize + y);
+            for (int x = 0; x < blockColumns * blockSize; x++){
+                sums[row][x / blockSize] += line[x];
+            }
+        }
+    }
+}
+
+void blockSums(const QImage &gray, int sums[blockRows][blockColumns]){
+#ifdef PHASH_SSE2
+    const __m128i zero = _mm_setzero_si128();
+
+    for (int row = 0; row < blockRows; row++){
+
+        //_mm_sad_epu8 sums 8 bytes at a time, so one 16 bytes load gives the sums of 2 blocks
+        __m128i acc[5] = { zero, zero, zero, zero, zero };
+
+        for (int y = 0; y < blockSize; y++){
+            const uchar *line = gray.constScanLine(row * blockSize + y);
+
+            for (int k = 0; k < 4; k++){
+                __m128i pixels = _mm_loadu_si128(reinterpret_cast<const __m128i*>(line + k * 16));
+                acc[k] = _mm_add_epi32(acc[k], _mm_sad_epu8(pixels, zero));
+            }
+
+            //9th block, only 8 bytes left
+            __m128i last = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(line + 64));
+            acc[4] = _mm_add_epi32(acc[4], _mm_sad_epu8(last, zero));
+        }
+
+        for (int k = 0; k < 4; k++){
+            sums[row][k * 2] = _mm_cvtsi128_si32(acc[k]);
+            sums[row][k * 2 + 1] = _mm_cvtsi128_si32(_mm_srli_si128(acc[k], 8));
+        }
+        sums[row][8] = _mm_cvtsi128_si32(acc[4]);
+    }
+#else
+    blockSumsScalar(gray, sums);
+#endif
+}
+
+quint64 differenceHash(const QImage &frame, bool *usable){
+    QImage gray = frame
+                      .scaled(blockColumns * blockSize, blockRows * blockSize, Qt::IgnoreAspectRatio, Qt::SmoothTransformation)
+                      .convertToFormat(QImage::Format_Grayscale8);
+
+    int sums[blockRows][blockColumns];
+    blockSums(gray, sums);
+
+    quint64 hash = 0;
+    int darkest = sums[0][0];
+    int brightest = sums[0][0];
+
+    for (int row = 0; row < blockRows; row++){
+        for (int column = 0; column < blockColumns; column++){
+            darkest = qMin(darkest, sums[row][column]);
+            brightest = qMax(brightest, sums[row][column]);
+        }
+
+        for (int column = 0; column < blockColumns - 1; column++){
+            hash <<= 1;
+            hash |= (sums[row][column] > sums[row][column + 1] ? 1 : 0);
+        }
+    }
+
+    if (usable) *usable = (brightest - darkest >= flatThreshold);
+
+    return hash;
+}
+
+VideoHash spriteHash(const QImage &sprite, int frameCount){
+    VideoHash hash;
+    if (sprite.isNull() || frameCount <= 0) return hash;
+
+    int frameWidth = sprite.width() / frameCount;
+
+    for (int i = 0; i < frameCount; i++){
+        bool usable = false;
+        hash.frames << differenceHash(sprite.copy(i * frameWidth, 0, frameWidth, sprite.height()), &usable);
+        hash.usable << usable;
+    }
+
+    return hash;
+}
+
+int hammingDistance(quint64 a, quint64 b){
+    //popcnt instruction when the cpu has it
+    return qPopulationCount(a ^ b);
+}
+
+double videoDistance(const VideoHash &a, const VideoHash &b){
+    int count = qMin(a.frames.size(), b.frames.size());
+    int common = 0;
+    int total = 0;
+
+    for (int i = 0; i < count; i++){
+        if (!a.usable.at(i) || !b.usable.at(i)) continue;
+
+        total += hammingDistance(a.frames.at(i), b.frames.at(i));
+        common++;
+    }
+
+    //A single matching frame is not enough to say two videos are the same
+    if (common < qMin(3, count)) return -1;
+
+    return static_cast<double>(total) / common;
+}
+
+void DuplicateIndex::add(const QString &id, const VideoHash &hash){
+    int index = ids.size();
+    ids << id;
+    hashes << hash;
+
+    for (int frame = 0; frame < hash.frames.size(); frame++){
+        if (!hash.usable.at(frame)) continue;
+
+        for (int band = 0; band < bandCount; band++){
+            quint8 value = (hash.frames.at(frame) >> (band * 8)) & 0xFF;
+            buckets[bucketKey(frame, band, value)] << index;
+        }
+    }
+}
+
+void DuplicateIndex::clear(){
+    ids.clear();
+    hashes.clear();
+    buckets.clear();
+}
+
+QString DuplicateIndex::findDuplicate(const VideoHash &hash) const{
+    QSet<int> compared;
+    int best = -1;
+
+    for (int frame = 0; frame < hash.frames.size(); frame++){
+        if (!hash.usable.at(frame)) continue;
+
+        for (int band = 0; band < bandCount; band++){
+            quint8 value = (hash.frames.at(frame) >> (band * 8)) & 0xFF;
+
+            for (int candidate : buckets.value(bucketKey(frame, band, value))){
+                if (compared.contains(candidate)) continue;
+                compared.insert(candidate);
+
+                double distance = videoDistance(hash, hashes.at(candidate));
+
+                //The first indexed one is the "original"
+                if (distance >= 0 && distance <= maxDistance && (best < 0 || candidate < best)){
+                    best = candidate;
+                }
+            }
+        }
+    }
+
+    return best < 0 ? "" : ids.at(best);
+}
+
+quint32 DuplicateIndex::bucketKey(int frame, int band, quint8 value){
+    return (static_cast<quint32>(frame) << 16) | (static_cast<quint32>(band) << 8) | value;
+}
@@ -0,0 +1,67 @@
+#ifndef PERCEPTUALHASH_H
+#define PERCEPTUALHASH_H
+
+#include <QImage>
+#include <QHash>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+
+//Perceptual hash of a video : one 64 bits difference hash (dHash) per sampled frame
+//Two videos with close hashes look the same, even if they were re-exported, resized or renamed
+struct VideoHash {
+    QVector<quint64> frames;
+
+    //Frames without any detail (black intro...) hash to 0 and would match anything, they are ignored
+    QVector<bool> usable;
+
+    bool isEmpty() const;
+};
+
+//dHash of a frame : the frame is reduced to 9x8 blocks and each bit tells if a block is brighter than its right neighbour
+//Returns false in usable if the frame is flat
+quint64 differenceHash(const QImage &frame, bool *usable = nullptr);
+
+//Sums of the pixels of each 8x8 block of a 72x64 grayscale image, 8 rows of 9 blocks, used by differenceHash
+//blockSums uses SSE2 when the cpu has it, blockSumsScalar is the plain version and gives the same sums
+void blockSums(const QImage &gray, int sums[8][9]);
+void blockSumsScalar(const QImage &gray, int sums[8][9]);
+
+//Hash of every frame of a sprite sheet (frames side by side)
+VideoHash spriteHash(const QImage &sprite, int frameCount);
+
+//Number of different bits
+int hammingDistance(quint64 a, quint64 b);
+
+//Mean distance of the frames usable in both hashes, -1 if they don't have enough frames in common
+double videoDistance(const VideoHash &a, const VideoHash &b);
+
+//Finds the videos looking like an already indexed one without comparing with every video
+//Each frame hash is split in bandCount bands, two frames with less different bits than bands share at least one
+//of them (pigeonhole). Two duplicates have a mean distance of at most maxDistance, so at least one of their frames
+//is within maxDistance too : only the videos sharing a band of a frame at the same place need to be compared
+class DuplicateIndex
+{
+public:
+    //Bands of 8 bits of each frame hash
+    static const int bandCount = 8;
+
+    //Mean number of different bits per frame under which two videos are duplicates, under bandCount for the pigeonhole
+    static constexpr double maxDistance = bandCount - 1;
+    static_assert(maxDistance < bandCount, "a duplicate could share no band with the original");
+
+    void add(const QString &id, const VideoHash &hash);
+    void clear();
+
+    //Id of the first indexed video looking like this one, empty if none
+    QString findDuplicate(const VideoHash &hash) const;
+
+private:
+    static quint32 bucketKey(int frame, int band, quint8 value);
+
+    QStringList ids;
+    QVector<VideoHash> hashes;
+    QHash<quint32, QVector<int>> buckets;
+};
+
+#endif // PERCEPTUALHASH_H
@@ -0,0 +1,213 @@
+#include "previewencoder.h"
+#include "encoderbackend.h"
+#include <QProcess>
+#include <QStandardPaths>
+#include <QDir>
+#include <QFileInfo>
+#include <QRegularExpression>
+
+PreviewEncoder::PreviewEncoder(const VideoJob &job, const QString &ffmpegPath, const QString &ffprobePath, QObject *parent)
+    : QObject(parent)
+    , previewJob(job)
+    , ffmpeg(ffmpegPath)
+    , ffprobe(ffprobePath)
+{
+    folder = QStandardPaths::writableLocation(QStandardPaths::CacheLocation) + "/preview";
+}
+
+const VideoJob& PreviewEncoder::job() const{
+    return previewJob;
+}
+
+QString PreviewEncoder::outputFolder() const{
+    return folder;
+}
+
+void PreviewEncoder::start(){
+
+    //Only the last preview is kept
+    QDir(folder).removeRecursively();
+    QDir().mkpath(folder);
+
+    emit stepChanged("Retrieving video data");
+
+    runProcess(ffprobe, ffprobeArgs(previewJob.inputPath), [=](QProcess *process){
+        probeFinished(process->readAllStandardOutput());
+    });
+}
+
+void PreviewEncoder::runProcess(const QString &program, const QStringList &args, std::function<void(QProcess*)> onSuccess){
+    QProcess *process = new QProcess(this);
+
+    //x264 and x265 use a relative path for their stats file
+    process->setWorkingDirectory(folder);
+
+    connect(process, &QProcess::finished, this, [=](int exitCode, QProcess::ExitStatus status){
+        if (exitCode != 0 || status != QProcess::NormalExit){
+            //Only the end of the output is useful
+            QStringList lines = QString(process->readAllStandardError()).split('\n', Qt::SkipEmptyParts);
+            emit failed("Error " + QFileInfo(program).baseName().toUpper() + " : " + QString::number(exitCode) + "\n"
+                        + lines.mid(qMax(0, lines.size() - 4)).join("\n"));
+            commands.clear();
+        }else{
+            onSuccess(process);
+        }
+        process->deleteLater();
+    });
+
+    //finished is never sent if the process couldn't even start (missing or not executable)
+    connect(process, &QProcess::errorOccurred, this, [=](QProcess::ProcessError error){
+        if (error != QProcess::FailedToStart) return;
+
+        emit failed("Couldn't start " + program + " !");
+        commands.clear();
+        process->deleteLater();
+    });
+
+    process->start(program, args);
+}
+
+//Lines of the stderr of a finished ffmpeg, its progress lines end with \r
+static QStringList outputLines(const QByteArray &output){
+    QStringList lines;
+    const QStringList all = QString::fromUtf8(output).split(QRegularExpression("[\r\n]"), Qt::SkipEmptyParts);
+    for (const QString &line : all){
+        if (line.trimmed() != "") lines << line.trimmed();
+    }
+    return lines;
+}
+
+void PreviewEncoder::probeFinished(const QByteArray &output){
+    readFfprobeOutput(output, previewJob.videoInfo);
+
+    if (previewJob.clipDuration() <= 0){
+        emit failed("The size limit can't be reached for this video !");
+        return;
+    }
+
+    detectCrop();
+}
+
+//Same black bars as the real compression, the parts are cropped the same way
+void PreviewEncoder::detectCrop(){
+    previewJob.videoInfo.cropWidth = 0;
+
+    if (!previewJob.detectCrop){
+        sampleDuplicates(0, 0, 0);
+        return;
+    }
+
+    emit stepChanged("Detecting black bars");
+
+    runProcess(ffmpeg, cropDetectArgs(previewJob), [=](QProcess *process){
+        readCropDetectOutput(outputLines(process->readAllStandardError()), previewJob.videoInfo);
+        sampleDuplicates(0, 0, 0);
+    });
+}
+
+//The static frames are looked for in the parts of the preview themselves, they're dropped with a variable fps
+//like in the real compression if there are enough of them
+void PreviewEncoder::sampleDuplicates(int part, double keptFrames, double totalFrames){
+    double clipLength = previewJob.clipDuration();
+    double length = qMin(segmentLength, clipLength / segmentCount);
+
+    if (part == 0){
+        previewJob.videoInfo.duplicateRatio = 0;
+
+        if (!previewJob.decimate || previewJob.outputFps() <= 0){
+            encodeParts();
+            return;
+        }
+
+        emit stepChanged("Looking for static frames");
+    }
+
+    if (part >= segmentCount){
+        if (totalFrames > 0){
+            previewJob.videoInfo.duplicateRatio = qBound(0.0, 1 - keptFrames / totalFrames, 1.0);
+        }
+        encodeParts();
+        return;
+    }
+
+    double start = previewJob.trimStart + clipLength * (part + 0.5) / segmentCount - length / 2;
+
+    runProcess(ffmpeg, duplicateSampleArgs(previewJob, start, length), [=](QProcess *process){
+        //Frames left after mpdecimate, from the last progress line
+        double kept = 0;
+        const QStringList lines = outputLines(process->readAllStandardError());
+        for (const QString &line : lines){
+            if (line.startsWith("frame=")) kept = line.mid(6).trimmed().section(' ', 0, 0).toDouble();
+        }
+
+        sampleDuplicates(part + 1, keptFrames + kept, totalFrames + length * previewJob.outputFps());
+    });
+}
+
+void PreviewEncoder::encodeParts(){
+    //Same maths as the real compression
+    if (!previewJob.computeEncodingSettings()){
+        emit failed("The size limit can't be reached for this video !");
+        return;
+    }
+
+    const EncoderBackend *encoder = EncoderBackend::byId(previewJob.encoder);
+    QString statsPrefix = folder + "/preview_pass";
+
+    double clipLength = previewJob.clipDuration();
+    double length = qMin(segmentLength, clipLength / segmentCount);
+
+    //Parts evenly spread on the video (or the trimmed part of it), ex : 1/6, 1/2 and 5/6 for 3 parts
+    for (int i = 0; i < segmentCount; i++){
+        double start = previewJob.trimStart + clipLength * (i + 0.5) / segmentCount - length / 2;
+        QString startArg = QString::number(start, 'f', 3);
+        QString lengthArg = QString::number(length, 'f', 3);
+        QString part = folder + "/part" + QString::number(i + 1) + "." + encoder->containerExtension();
+        QString image = folder + "/compare" + QString::number(i + 1) + ".png";
+        QString step = "Part " + QString::number(i + 1) + "/" + QString::number(segmentCount);
+
+        QStringList input = { "-y", "-ss", startArg, "-i", previewJob.inputPath, "-t", lengthArg };
+        input << previewJob.rateArgs() << previewJob.filterArgs();
+
+        if (encoder->passCount() >= 2){
+            commands << qMakePair(step + " - Pass 1", QStringList()
+                                  << input
+                                  << encoder->passArgs(1, previewJob.videoInfo.videoBitrateKbps, statsPrefix, previewJob.preset)
+                                  << encoder->threadArgs()
+                                  << "-an" << "-f" << "null" << "NUL");
+        }
+
+        commands << qMakePair(step + " - Encoding", QStringList()
+                              << input
+                              << encoder->passArgs(encoder->passCount(), previewJob.videoInfo.videoBitrateKbps, statsPrefix, previewJob.preset)
+                              << encoder->threadArgs()
+                              << encoder->audioArgs(previewJob.videoInfo.audioBitrateKbps)
+                              << part);
+
+        //Frame of the middle of the part, source on the left and compressed on the right, both at the same height
+        commands << qMakePair(step + " - Comparing", QStringList()
+                              << "-y"
+                              << "-ss" << QString::number(start + length / 2, 'f', 3) << "-i" << previewJob.inputPath
+                              << "-ss" << QString::number(length / 2, 'f', 3) << "-i" << part
+                              << "-filter_complex" << "[0:v]scale=-2:360,setsar=1[a];[1:v]scale=-2:360,setsar=1[b];[a][b]hstack"
+                              << "-frames:v" << "1" << image);
+
+        images << image;
+    }
+
+    runNextCommand();
+}
+
+void PreviewEncoder::runNextCommand(){
+    if (commands.isEmpty()){
+        emit finished(images);
+        return;
+    }
+
+    QPair<QString, QStringList> command = commands.takeFirst();
+    emit stepChanged(command.first);
+
+    runProcess(ffmpeg, command.second, [=](QProcess*){
+        runNextCommand();
+    });
+}
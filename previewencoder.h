@@ -0,0 +1,66 @@
+#ifndef PREVIEWENCODER_H
+#define PREVIEWENCODER_H
+
+#include <QObject>
+#include <QStringList>
+#include <QList>
+#include <QPair>
+#include <QProcess>
+#include <functional>
+#include "videojob.h"
+
+//Encodes a few short parts of a video with the exact bitrate, fps, crop, static frames and encoder of the real compression,
+//then puts a frame of each part next to the same frame of the source
+//Takes a few seconds, so that bad settings are seen before compressing the whole video
+class PreviewEncoder : public QObject
+{
+    Q_OBJECT
+
+public:
+    PreviewEncoder(const VideoJob &job, const QString &ffmpegPath, const QString &ffprobePath, QObject *parent = nullptr);
+
+    void start();
+
+    //Job with the computed settings, once probed
+    const VideoJob& job() const;
+
+    //Folder containing the encoded parts and the comparison images
+    QString outputFolder() const;
+
+signals:
+    void stepChanged(QString step);
+
+    //One image per part, source on the left, compressed on the right
+    void finished(QStringList comparisonImages);
+
+    void failed(QString error);
+
+private:
+    void probeFinished(const QByteArray &output);
+    void detectCrop();
+
+    //part is the part being sampled, keptFrames and totalFrames the counts of the parts done
+    void sampleDuplicates(int part, double keptFrames, double totalFrames);
+
+    //Builds the commands of every part with the settings found, then runs them
+    void encodeParts();
+    void runNextCommand();
+
+    //Runs a process in the preview folder, failed is sent if it fails or can't start, onSuccess is called otherwise
+    void runProcess(const QString &program, const QStringList &args, std::function<void(QProcess*)> onSuccess);
+
+    //Number of parts encoded and their length in seconds
+    static const int segmentCount = 3;
+    static constexpr double segmentLength = 4;
+
+    VideoJob previewJob;
+    QString ffmpeg;
+    QString ffprobe;
+    QString folder;
+
+    //ffmpeg commands left to run with the step shown in the ui
+    QList<QPair<QString, QStringList>> commands;
+    QStringList images;
+};
+
+#endif // PREVIEWENCODER_H
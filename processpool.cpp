@@ -0,0 +1,43 @@
+#include "processpool.h"
+
+ProcessPool::ProcessPool(int maxRunning, QObject *parent)
+    : QObject(parent)
+    , maxRunning(maxRunning > 0 ? maxRunning : 1)
+{
+}
+
+void ProcessPool::enqueue(const QString &program, const QStringList &args, Callback onFinished){
+    tasks.enqueue({ program, args, onFinished });
+    startNext();
+}
+
+int ProcessPool::pendingCount() const{
+    return tasks.count();
+}
+
+void ProcessPool::startNext(){
+    while (running < maxRunning && !tasks.isEmpty()){
+        Task task = tasks.dequeue();
+        running++;
+
+        QProcess *process = new QProcess(this);
+
+        //Called once, either when the process is done or when it couldn't even start
+        auto done = [=](int exitCode){
+            if (task.onFinished) task.onFinished(exitCode, process);
+            process->deleteLater();
+            running--;
+            startNext();
+        };
+
+        connect(process, &QProcess::finished, this, [=](int exitCode, QProcess::ExitStatus status){
+            done(status == QProcess::NormalExit ? exitCode : -1);
+        });
+
+        connect(process, &QProcess::errorOccurred, this, [=](QProcess::ProcessError error){
+            if (error == QProcess::FailedToStart) done(-1);
+        });
+
+        process->start(task.program, task.args);
+    }
+}
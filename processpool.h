@@ -0,0 +1,40 @@
+#ifndef PROCESSPOOL_H
+#define PROCESSPOOL_H
+
+#include <QObject>
+#include <QProcess>
+#include <QQueue>
+#include <functional>
+
+//Runs background processes (thumbnails, previews of the list...) with a limited amount at the same time
+//so that adding a lot of videos doesn't start hundreds of ffmpeg instances at once
+class ProcessPool : public QObject
+{
+    Q_OBJECT
+
+public:
+    //exitCode is -1 if the process couldn't be started, the process is deleted after the callback
+    using Callback = std::function<void(int exitCode, QProcess *process)>;
+
+    explicit ProcessPool(int maxRunning, QObject *parent = nullptr);
+
+    void enqueue(const QString &program, const QStringList &args, Callback onFinished);
+
+    //Processes waiting for a free slot
+    int pendingCount() const;
+
+private:
+    struct Task {
+        QString program;
+        QStringList args;
+        Callback onFinished;
+    };
+
+    void startNext();
+
+    QQueue<Task> tasks;
+    int running = 0;
+    int maxRunning;
+};
+
+#endif // PROCESSPOOL_H
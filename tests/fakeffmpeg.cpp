@@ -0,0 +1,140 @@
+//Stand-in ffmpeg (and ffprobe when built with FAKE_PROBE) for the stress test of the engine
+//Nothing is decoded or encoded : it answers with the same kind of outputs as the real ones, the probe json,
+//the log lines and the progress lines ending with \r, and writes a tiny output file
+//Set by environment variables, read by every process started by the engine :
+//  FAKE_FFMPEG_DURATION        duration in seconds of every video (10)
+//  FAKE_FFMPEG_PROGRESS_LINES  progress lines sent by every command (4)
+//  FAKE_FFMPEG_SPEED           encoding speed compared to the real time, 0 = as fast as possible (0)
+//  FAKE_FFMPEG_FAIL_MATCH      the commands containing this text fail halfway with the exit code 1
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <thread>
+#include <vector>
+
+static double envNumber(const char *name, double fallback){
+    const char *value = std::getenv(name);
+    return value && *value ? std::atof(value) : fallback;
+}
+
+static std::string envText(const char *name){
+    const char *value = std::getenv(name);
+    return value ? value : "";
+}
+
+#ifndef FAKE_PROBE
+//ex : 00:00:05.12
+static std::string timestamp(double seconds){
+    int hundredths = static_cast<int>(seconds * 100 + 0.5);
+    char text[32];
+    std::snprintf(text, sizeof(text), "%02d:%02d:%02d.%02d",
+                  hundredths / 360000, hundredths / 6000 % 60, hundredths / 100 % 60, hundredths % 100);
+    return text;
+}
+#endif
+
+static std::string valueAfter(const std::vector<std::string> &args, const std::string &key){
+    for (size_t i = 0; i + 1 < args.size(); i++){
+        if (args[i] == key) return args[i + 1];
+    }
+    return "";
+}
+
+static int fail(const std::string &program, const std::string &reason){
+    std::fprintf(stderr, "\n[%s @ 0x5555fake] %s\nConversion failed!\n", program.c_str(), reason.c_str());
+    return 1;
+}
+
+int main(int argc, char **argv){
+    std::vector<std::string> args(argv + 1, argv + argc);
+
+    std::string commandLine;
+    for (const std::string &arg : args) commandLine += arg + " ";
+
+    if (!args.empty() && args[0] == "-version"){
+        std::printf("ffmpeg version n0.0-fake Copyright (c) the stand-in\n");
+        return 0;
+    }
+
+    double duration = envNumber("FAKE_FFMPEG_DURATION", 10);
+    std::string failMatch = envText("FAKE_FFMPEG_FAIL_MATCH");
+    bool failing = !failMatch.empty() && commandLine.find(failMatch) != std::string::npos;
+    std::string input = valueAfter(args, "-i");
+
+#ifdef FAKE_PROBE
+    if (failing) return fail("mov,mp4,m4a,3gp,3g2,mj2", input + ": Invalid data found when processing input");
+
+    std::printf("{\n"
+                "    \"programs\": [\n\n    ],\n"
+                "    \"streams\": [\n"
+                "        {\n"
+                "            \"index\": 0,\n"
+                "            \"codec_type\": \"video\",\n"
+                "            \"width\": 1920,\n"
+                "            \"height\": 1080,\n"
+                "            \"avg_frame_rate\": \"30/1\",\n"
+                "            \"bit_rate\": \"4000000\"\n"
+                "        },\n"
+                "        {\n"
+                "            \"index\": 1,\n"
+                "            \"codec_type\": \"audio\",\n"
+                "            \"sample_rate\": \"48000\",\n"
+                "            \"channels\": 2,\n"
+                "            \"bit_rate\": \"128000\"\n"
+                "        }\n"
+                "    ],\n"
+                "    \"format\": {\n"
+                "        \"duration\": \"%.6f\",\n"
+                "        \"bit_rate\": \"4128000\"\n"
+                "    }\n"
+                "}\n", duration);
+    return 0;
+#else
+    //-t before the input : length of the clip
+    std::string length = valueAfter(args, "-t");
+    if (!length.empty()) duration = std::atof(length.c_str());
+
+    int progressLines = static_cast<int>(envNumber("FAKE_FFMPEG_PROGRESS_LINES", 4));
+    double speed = envNumber("FAKE_FFMPEG_SPEED", 0);
+    std::string output = args.empty() ? "" : args.back();
+
+    std::fprintf(stderr, "ffmpeg version n0.0-fake Copyright (c) the stand-in\n"
+                         "Input #0, mov,mp4,m4a,3gp,3g2,mj2, from '%s':\n"
+                         "  Duration: %s, start: 0.000000, bitrate: 4128 kb/s\n"
+                         "Stream mapping:\n"
+                         "  Stream #0:0 -> #0:0 (h264 (native) -> h264 (libx264))\n"
+                         "Output #0, mp4, to '%s':\n",
+                 input.c_str(), timestamp(duration).c_str(), output.c_str());
+
+    for (int i = 1; i <= progressLines; i++){
+        double time = duration * i / progressLines;
+
+        if (speed > 0){
+            std::this_thread::sleep_for(std::chrono::duration<double>(duration / progressLines / speed));
+        }
+
+        std::fprintf(stderr, "frame=%5d fps= 60 q=28.0 size=%8dkB time=%s bitrate=1000.0kbits/s speed=%.2fx\r",
+                     static_cast<int>(time * 30), static_cast<int>(time * 125), timestamp(time).c_str(),
+                     speed > 0 ? speed : 9.99);
+        std::fflush(stderr);
+
+        if (failing && i >= progressLines / 2){
+            return fail("libx264", "Error while writing " + output);
+        }
+    }
+
+    //Pass 1 and analysis commands write nothing, -f null NUL
+    if (!output.empty() && output != "NUL" && output.find('%') == std::string::npos){
+        FILE *file = std::fopen(output.c_str(), "wb");
+        if (!file) return fail("out", output + ": No such file or directory");
+
+        std::fputs("fake", file);
+        std::fclose(file);
+    }
+
+    std::fprintf(stderr, "\nvideo:%dkB audio:%dkB subtitle:0kB other streams:0kB global headers:0kB muxing overhead: 0.1%%\n",
+                 static_cast<int>(duration * 125), static_cast<int>(duration * 16));
+    return 0;
+#endif
+}
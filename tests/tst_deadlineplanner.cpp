@@ -0,0 +1,156 @@
+#include <QtTest>
+#include "deadlineplanner.h"
+#include "encoderbackend.h"
+
+//Presets and fps chosen by the planner, with a speed measured before so that the estimates don't depend on the cpu
+//x264 measured at 1x for 1080p30 at medium : a 60 s 1080p30 clip takes 22.9 s at ultrafast (both passes),
+//28.2 s at superfast and 34.8 s at veryfast
+class TestDeadlinePlanner : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void plentyOfTime();
+    void startsAtUltrafast();
+    void fpsLoweredOnlyAsNeeded();
+    void worstPresetFirst();
+    void currentJobLockedAfterPass1();
+    void droppedFramesNotCounted();
+};
+
+static VideoJob clip(double fps, double duration = 60){
+    VideoJob job;
+    job.inputPath = "/videos/clip.mp4";
+    job.videoInfo.duration = duration;
+    job.videoInfo.fps = fps;
+    job.videoInfo.width = 1920;
+    job.videoInfo.height = 1080;
+    return job;
+}
+
+//Deadline in the given number of seconds, the speed of the encoder already known
+static DeadlinePlanner planner(double seconds){
+    DeadlinePlanner planner;
+    planner.setDeadline(QDateTime::currentDateTime().addMSecs(qint64(seconds * 1000)));
+
+    VideoJob measured = clip(30);
+    measured.preset = "medium";
+    planner.addSpeedSample(measured, 2, 1);
+
+    return planner;
+}
+
+void TestDeadlinePlanner::plentyOfTime(){
+    DeadlinePlanner day = planner(24 * 3600);
+    QList<VideoJob> jobs = { clip(30), clip(60) };
+
+    day.plan(jobs, false);
+
+    for (const VideoJob &job : jobs){
+        QCOMPARE(job.preset, QString("veryslow"));
+        QCOMPARE(job.plannedFpsLimit, 0);
+    }
+}
+
+//Not even the fastest preset at the lowest fps makes it : the queue runs as fast as it can and will be late
+void TestDeadlinePlanner::startsAtUltrafast(){
+    DeadlinePlanner late = planner(1);
+    QList<VideoJob> jobs = { clip(60), clip(30), clip(29.97), clip(24) };
+
+    double total = late.plan(jobs, false);
+    QVERIFY(total > 1);
+
+    for (const VideoJob &job : jobs){
+        QCOMPARE(job.preset, QString("ultrafast"));
+    }
+
+    //30 then 24, 29.97 is not capped to 30 and 24 fps has nothing under it
+    QCOMPARE(jobs.at(0).plannedFpsLimit, 24);
+    QCOMPARE(jobs.at(1).plannedFpsLimit, 24);
+    QCOMPARE(jobs.at(2).plannedFpsLimit, 24);
+    QCOMPARE(jobs.at(3).plannedFpsLimit, 0);
+}
+
+//At 60 fps even ultrafast takes 45.8 s, at 30 fps it takes 22.9 s and the time left goes into the preset
+void TestDeadlinePlanner::fpsLoweredOnlyAsNeeded(){
+    DeadlinePlanner halfMinute = planner(30);
+    QList<VideoJob> jobs = { clip(60) };
+
+    double total = halfMinute.plan(jobs, false);
+
+    QCOMPARE(jobs.at(0).plannedFpsLimit, 30);
+    QCOMPARE(jobs.at(0).preset, QString("superfast"));
+    QVERIFY(total <= 30);
+}
+
+//Two clips in 66 s : 45.8 s at ultrafast, each step up goes to the clip with the worst preset
+//superfast for both (56.4 s), then veryfast for the first one (63 s), the second one would be 69.6 s
+void TestDeadlinePlanner::worstPresetFirst(){
+    DeadlinePlanner minute = planner(66);
+    QList<VideoJob> jobs = { clip(30), clip(30) };
+
+    minute.plan(jobs, false);
+
+    QCOMPARE(jobs.at(0).preset, QString("veryfast"));
+    QCOMPARE(jobs.at(1).preset, QString("superfast"));
+    QCOMPARE(jobs.at(0).plannedFpsLimit, 0);
+    QCOMPARE(jobs.at(1).plannedFpsLimit, 0);
+
+    //A long clip doesn't stay at ultrafast while a short one gets every step
+    DeadlinePlanner longQueue = planner(600 * 0.382 + 60);
+    QList<VideoJob> mixed = { clip(30, 600), clip(30, 10) };
+
+    longQueue.plan(mixed, false);
+
+    QStringList presets = EncoderBackend::byId("libx264")->presets();
+    int longLevel = presets.indexOf(mixed.at(0).preset);
+    int shortLevel = presets.indexOf(mixed.at(1).preset);
+    QVERIFY(longLevel > 0);
+    QVERIFY2(shortLevel - longLevel <= 1, qPrintable(mixed.at(0).preset + " / " + mixed.at(1).preset));
+}
+
+//The pass 2 must use the settings the stats of the pass 1 were made with
+void TestDeadlinePlanner::currentJobLockedAfterPass1(){
+    QList<VideoJob> jobs = { clip(60), clip(60) };
+    jobs[0].preset = "slow";
+    jobs[0].plannedFpsLimit = 24;
+
+    DeadlinePlanner day = planner(24 * 3600);
+    day.plan(jobs, true);
+
+    QCOMPARE(jobs.at(0).preset, QString("slow"));
+    QCOMPARE(jobs.at(0).plannedFpsLimit, 24);
+    QCOMPARE(jobs.at(1).preset, QString("veryslow"));
+    QCOMPARE(jobs.at(1).plannedFpsLimit, 0);
+
+    jobs[0].preset = "veryslow";
+    jobs[0].plannedFpsLimit = 0;
+
+    DeadlinePlanner late = planner(1);
+    late.plan(jobs, true);
+
+    QCOMPARE(jobs.at(0).preset, QString("veryslow"));
+    QCOMPARE(jobs.at(0).plannedFpsLimit, 0);
+    QCOMPARE(jobs.at(1).preset, QString("ultrafast"));
+    QCOMPARE(jobs.at(1).plannedFpsLimit, 24);
+}
+
+//A screen recording losing half of its frames costs the same as the same clip at half the fps, no cap needed
+void TestDeadlinePlanner::droppedFramesNotCounted(){
+    VideoJob recording = clip(60);
+    recording.decimate = true;
+    recording.videoInfo.duplicateRatio = 0.5;
+    QVERIFY(recording.isDecimated());
+
+    DeadlinePlanner halfMinute = planner(30);
+    QList<VideoJob> jobs = { recording };
+
+    double total = halfMinute.plan(jobs, false);
+
+    QCOMPARE(jobs.at(0).plannedFpsLimit, 0);
+    QCOMPARE(jobs.at(0).preset, QString("superfast"));
+    QVERIFY(total <= 30);
+}
+
+QTEST_GUILESS_MAIN(TestDeadlinePlanner)
+#include "tst_deadlineplanner.moc"
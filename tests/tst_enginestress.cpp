@@ -0,0 +1,290 @@
+#include <QtTest>
+#include <QTemporaryDir>
+#include <QThread>
+#include <QFile>
+#include "compressionengine.h"
+
+//Runs the real engine over a huge queue with the stand-in ffmpeg and ffprobe (fakeffmpeg.cpp), nothing is encoded
+//so that only the cost of the engine itself is left : starting the processes, reading their outputs, the signals
+//sent to the ui and the memory kept between the jobs. GVC_STRESS_JOBS changes the number of jobs (10000)
+class TestEngineStress : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+    void cleanupTestCase();
+    void cleanup();
+
+    void hugeQueue();
+    void failedJobStopsTheQueue();
+    void failedPartReportsItsOwnOutput();
+    void missingProgram();
+
+private:
+    //What the ui would have received
+    struct Run {
+        bool finished = false;
+        QStringList errors;
+        int jobsStarted = 0;
+        int steps = 0;
+        int progressUpdates = 0;
+        qint64 elapsedMs = 0;
+
+        //Time spent by the ui in the slots and in its refresh timer, in ms
+        double uiMs = 0;
+        int refreshes = 0;
+
+        //Resident memory after the first jobs and at the end, in kB (-1 if unknown)
+        qint64 warmMemoryKb = -1;
+        qint64 endMemoryKb = -1;
+    };
+
+    QList<VideoJob> fakeJobs(int count, const QString &prefix = "clip");
+    Run runEngine(const QList<VideoJob> &jobs, const QString &ffmpeg, const QString &ffprobe, int timeoutMs);
+
+    QThread engineThread;
+    CompressionEngine *engine = nullptr;
+    QTemporaryDir outputFolder;
+};
+
+//Same rate as the refresh timer of the main window
+static const int uiRefreshRateHz = 10;
+
+static qint64 residentMemoryKb(){
+    QFile status("/proc/self/status");
+    if (!status.open(QIODevice::ReadOnly | QIODevice::Text)) return -1;
+
+    while (!status.atEnd()){
+        QByteArray line = status.readLine();
+        if (line.startsWith("VmRSS:")) return line.mid(6).trimmed().split(' ').first().toLongLong();
+    }
+    return -1;
+}
+
+void TestEngineStress::initTestCase(){
+    //The logs and stats of the engine go into a cache made for the tests
+    QStandardPaths::setTestModeEnabled(true);
+
+    QVERIFY(outputFolder.isValid());
+
+    engine = new CompressionEngine();
+    engine->moveToThread(&engineThread);
+    connect(&engineThread, &QThread::finished, engine, &QObject::deleteLater);
+    engineThread.start();
+}
+
+void TestEngineStress::cleanupTestCase(){
+    QMetaObject::invokeMethod(engine, &CompressionEngine::abort);
+    engineThread.quit();
+    engineThread.wait();
+
+    QDir(QStandardPaths::writableLocation(QStandardPaths::CacheLocation)).removeRecursively();
+}
+
+void TestEngineStress::cleanup(){
+    qunsetenv("FAKE_FFMPEG_FAIL_MATCH");
+    qunsetenv("FAKE_FFMPEG_DURATION");
+}
+
+QList<VideoJob> TestEngineStress::fakeJobs(int count, const QString &prefix){
+    QList<VideoJob> jobs;
+    jobs.reserve(count);
+
+    for (int i = 0; i < count; i++){
+        VideoJob job;
+        job.inputPath = "/videos/" + prefix + QString::number(i + 1) + ".mp4";
+        job.outputPath = outputFolder.filePath(prefix + QString::number(i + 1) + ".mp4");
+        job.targetBits = 8ull * 8000000;
+        job.detectCrop = false;
+        job.decimate = false;
+        jobs << job;
+    }
+
+    return jobs;
+}
+
+TestEngineStress::Run TestEngineStress::runEngine(const QList<VideoJob> &jobs, const QString &ffmpeg, const QString &ffprobe, int timeoutMs){
+    Run run;
+    QEventLoop loop;
+
+    //Every connection goes away with it
+    QObject receiver;
+    QElapsedTimer uiTimer;
+    bool infoChanged = false;
+    QString fileName;
+    QString step;
+    double progress = 0;
+
+    int warmJob = qMin(1000, qMax(1, jobs.count() / 10));
+
+    connect(engine, &CompressionEngine::jobStarted, &receiver, [&](int fileIndex, int, QString name, QString){
+        uiTimer.start();
+        run.jobsStarted++;
+        fileName = name;
+        infoChanged = true;
+        if (fileIndex == warmJob) run.warmMemoryKb = residentMemoryKb();
+        run.uiMs += uiTimer.nsecsElapsed() / 1e6;
+    });
+
+    connect(engine, &CompressionEngine::stepChanged, &receiver, [&](QString newStep, int, int){
+        uiTimer.start();
+        run.steps++;
+        step = newStep;
+        infoChanged = true;
+        run.uiMs += uiTimer.nsecsElapsed() / 1e6;
+    });
+
+    connect(engine, &CompressionEngine::progressChanged, &receiver, [&](double passProgress){
+        uiTimer.start();
+        run.progressUpdates++;
+        progress = passProgress;
+        infoChanged = true;
+        run.uiMs += uiTimer.nsecsElapsed() / 1e6;
+    });
+
+    connect(engine, &CompressionEngine::jobFailed, &receiver, [&](QString error){
+        run.errors << error;
+        loop.quit();
+    });
+
+    connect(engine, &CompressionEngine::allFinished, &receiver, [&](){
+        run.finished = true;
+        loop.quit();
+    });
+
+    //Same work as the refresh of the main window : the text of the log label
+    QTimer refresh;
+    connect(&refresh, &QTimer::timeout, &receiver, [&](){
+        if (!infoChanged) return;
+        infoChanged = false;
+
+        uiTimer.start();
+        QString text = "File Name : " + fileName + "\nCurrent Step : " + step + "\n" + QString::number(progress * 100, 'f', 1) + "%";
+        Q_UNUSED(text);
+        run.refreshes++;
+        run.uiMs += uiTimer.nsecsElapsed() / 1e6;
+    });
+    refresh.start(1000 / uiRefreshRateHz);
+
+    QTimer::singleShot(timeoutMs, &loop, &QEventLoop::quit);
+
+    QElapsedTimer elapsed;
+    elapsed.start();
+
+    QMetaObject::invokeMethod(engine, [=](){
+        engine->start(jobs, ffmpeg, ffprobe, QDateTime());
+    });
+
+    loop.exec();
+    run.elapsedMs = elapsed.elapsed();
+    run.endMemoryKb = residentMemoryKb();
+
+    //Anything sent after the end would be a bug (a second error, a job started after the failure)
+    QTest::qWait(300);
+
+    return run;
+}
+
+void TestEngineStress::hugeQueue(){
+    int jobCount = qEnvironmentVariableIsSet("GVC_STRESS_JOBS") ? qEnvironmentVariableIntValue("GVC_STRESS_JOBS") : 10000;
+    QVERIFY(jobCount > 0);
+
+    Run run = runEngine(fakeJobs(jobCount), FAKE_FFMPEG_PATH, FAKE_FFPROBE_PATH, qMax(60000, jobCount * 100));
+
+    QVERIFY2(run.errors.isEmpty(), qPrintable(run.errors.join("\n")));
+    QVERIFY2(run.finished, "The queue didn't finish in time");
+    QCOMPARE(run.jobsStarted, jobCount);
+
+    //ffprobe, pass 1 and pass 2 for every job
+    double msPerJob = static_cast<double>(run.elapsedMs) / jobCount;
+    qInfo("%d jobs in %.1f s : %.2f ms per job, %.2f ms per process",
+          jobCount, run.elapsedMs / 1000.0, msPerJob, msPerJob / 3);
+    qInfo("ui : %.2f signals per job, %d refreshes, %.3f ms in the ui (%.2f%% of the time)",
+          double(run.steps + run.progressUpdates + run.jobsStarted) / jobCount, run.refreshes, run.uiMs,
+          100 * run.uiMs / qMax<qint64>(1, run.elapsedMs));
+
+    //The progress is only sent when it moves : 4 progress lines per pass, 2 passes
+    QVERIFY(run.progressUpdates <= jobCount * 8);
+    QCOMPARE(run.steps, jobCount * 3);
+
+    //The ui must never be the bottleneck
+    QVERIFY(run.uiMs < run.elapsedMs * 0.05);
+
+    //A whole job without encoding is mostly the start of three processes
+    QVERIFY2(msPerJob < 200, qPrintable(QString::number(msPerJob) + " ms per job"));
+
+    //Every job is forgotten once done : logs, processes and outputs of ffmpeg
+    if (run.warmMemoryKb > 0 && run.endMemoryKb > 0){
+        qint64 growthKb = run.endMemoryKb - run.warmMemoryKb;
+        qInfo("memory : %lld kB after the first jobs, %lld kB at the end", run.warmMemoryKb, run.endMemoryKb);
+        QVERIFY2(growthKb < 32 * 1024, qPrintable(QString::number(growthKb) + " kB more at the end"));
+    }
+
+    //The stand-in writes every output
+    QCOMPARE(QDir(outputFolder.path()).entryList({ "clip*.mp4" }, QDir::Files).count(), jobCount);
+}
+
+void TestEngineStress::failedJobStopsTheQueue(){
+    //The pass 2 of the 7th job fails
+    QList<VideoJob> jobs = fakeJobs(20, "queue");
+    jobs[6].outputPath = outputFolder.filePath("queue7_broken.mp4");
+    qputenv("FAKE_FFMPEG_FAIL_MATCH", "broken");
+
+    Run run = runEngine(jobs, FAKE_FFMPEG_PATH, FAKE_FFPROBE_PATH, 60000);
+
+    QVERIFY(!run.finished);
+    QCOMPARE(run.errors.count(), 1);
+    QCOMPARE(run.jobsStarted, 7);
+
+    //The lines of ffmpeg telling why, the progress lines are not part of it
+    QString error = run.errors.first();
+    QVERIFY2(error.startsWith("Error FAKE_FFMPEG : 1"), qPrintable(error));
+    QVERIFY2(error.contains("Error while writing " + jobs.at(6).outputPath), qPrintable(error));
+    QVERIFY2(error.contains("Conversion failed!"), qPrintable(error));
+    QVERIFY2(!error.contains("frame="), qPrintable(error));
+
+    QCOMPARE(QDir(outputFolder.path()).entryList({ "queue*.mp4" }, QDir::Files).count(), 6);
+}
+
+void TestEngineStress::failedPartReportsItsOwnOutput(){
+    //10 minutes in 8 MB : the video is split and its parts encoded a few at a time, the pass 2 of the 3rd one fails
+    QList<VideoJob> jobs = fakeJobs(1, "long");
+    jobs[0].splitIntoParts = true;
+    qputenv("FAKE_FFMPEG_DURATION", "600");
+    qputenv("FAKE_FFMPEG_FAIL_MATCH", "long1_part3.");
+
+    Run run = runEngine(jobs, FAKE_FFMPEG_PATH, FAKE_FFPROBE_PATH, 60000);
+
+    QVERIFY(!run.finished);
+    QCOMPARE(run.errors.count(), 1);
+
+    //Only the lines of the part that failed, not the ones of the parts running next to it
+    QString error = run.errors.first();
+    QVERIFY2(error.contains("Error while writing " + outputFolder.filePath("long1_part3.mp4")), qPrintable(error));
+    QVERIFY2(!error.contains("_part2.") && !error.contains("_part4."), qPrintable(error));
+}
+
+void TestEngineStress::missingProgram(){
+    Run run = runEngine(fakeJobs(3, "missing"), FAKE_FFMPEG_PATH, outputFolder.filePath("no_ffprobe"), 60000);
+
+    QVERIFY(!run.finished);
+    QCOMPARE(run.errors.count(), 1);
+    QVERIFY2(run.errors.first().startsWith("Couldn't start"), qPrintable(run.errors.first()));
+    QCOMPARE(run.jobsStarted, 1);
+
+    //The parts of a split video start a few at a time : only the first one may fail, the others are never started
+    QList<VideoJob> jobs = fakeJobs(2, "missingparts");
+    jobs[0].splitIntoParts = true;
+    qputenv("FAKE_FFMPEG_DURATION", "600");
+
+    run = runEngine(jobs, outputFolder.filePath("no_ffmpeg"), FAKE_FFPROBE_PATH, 60000);
+
+    QVERIFY(!run.finished);
+    QCOMPARE(run.errors.count(), 1);
+    QVERIFY2(run.errors.first().startsWith("Couldn't start"), qPrintable(run.errors.first()));
+    QCOMPARE(run.jobsStarted, 1);
+}
+
+QTEST_GUILESS_MAIN(TestEngineStress)
+#include "tst_enginestress.moc"
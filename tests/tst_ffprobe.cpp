@@ -0,0 +1,129 @@
+#include <QtTest>
+#include "videojob.h"
+
+//VideoInfo read from the json of ffprobe, for the containers that don't give every bitrate
+class TestFfprobe : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void argsAskForTheBitrateTags();
+    void mp4Bitrates();
+    void matroskaBitrateTags();
+    void matroskaWithoutTags();
+    void unknownAudioBitrate();
+    void noAudio();
+};
+
+void TestFfprobe::argsAskForTheBitrateTags(){
+    QStringList args = ffprobeArgs("/videos/clip.mkv");
+    int index = args.indexOf("-show_entries");
+    QVERIFY(index >= 0);
+    QVERIFY(args.at(index + 1).contains("stream_tags=BPS"));
+}
+
+void TestFfprobe::mp4Bitrates(){
+    VideoInfo info;
+    readFfprobeOutput(R"({
+        "streams": [
+            { "index": 0, "codec_type": "video", "width": 1920, "height": 1080, "avg_frame_rate": "30000/1001", "bit_rate": "5000000" },
+            { "index": 1, "codec_type": "audio", "sample_rate": "48000", "channels": 2, "bit_rate": "160000" }
+        ],
+        "format": { "duration": "60.000000", "bit_rate": "5170000" }
+    })", info);
+
+    QCOMPARE(info.duration, 60.0);
+    QCOMPARE(info.width, 1920);
+    QCOMPARE(info.height, 1080);
+    QVERIFY(qAbs(info.fps - 29.97) < 0.01);
+    QCOMPARE(info.sourceBitrateKbps, 5170);
+    QCOMPARE(info.audioBitrateKbps, 160);
+}
+
+//What ffprobe gives for a file made by mkvmerge or ffmpeg : no bit_rate, the BPS tag instead
+void TestFfprobe::matroskaBitrateTags(){
+    VideoInfo info;
+    readFfprobeOutput(R"({
+        "programs": [],
+        "streams": [
+            { "index": 0, "codec_type": "video", "width": 1280, "height": 720, "avg_frame_rate": "24/1",
+              "tags": { "BPS": "2400000" } },
+            { "index": 1, "codec_type": "audio", "sample_rate": "48000", "channels": 2,
+              "tags": { "BPS": "192000" } }
+        ],
+        "format": { "duration": "120.500000", "bit_rate": "2610000" }
+    })", info);
+
+    QCOMPARE(info.duration, 120.5);
+    QCOMPARE(info.fps, 24.0);
+    QCOMPARE(info.audioBitrateKbps, 192);
+
+    //Older mkvmerge versions add the language to the tag
+    VideoInfo old;
+    readFfprobeOutput(R"({
+        "streams": [
+            { "index": 0, "codec_type": "video", "width": 1280, "height": 720, "avg_frame_rate": "24/1" },
+            { "index": 1, "codec_type": "audio", "sample_rate": "48000", "channels": 2, "tags": { "BPS-eng": "96000" } }
+        ],
+        "format": { "duration": "10.000000", "bit_rate": "2000000" }
+    })", old);
+
+    QCOMPARE(old.audioBitrateKbps, 96);
+}
+
+//Only the video has its tag : the audio gets what's left of the file, capped
+void TestFfprobe::matroskaWithoutTags(){
+    VideoInfo info;
+    readFfprobeOutput(R"({
+        "streams": [
+            { "index": 0, "codec_type": "video", "width": 1280, "height": 720, "avg_frame_rate": "30/1",
+              "tags": { "BPS": "3000000" } },
+            { "index": 1, "codec_type": "audio", "sample_rate": "48000", "channels": 2 }
+        ],
+        "format": { "duration": "30.000000", "bit_rate": "3128000" }
+    })", info);
+
+    QCOMPARE(info.audioBitrateKbps, 128);
+
+    VideoInfo capped;
+    readFfprobeOutput(R"({
+        "streams": [
+            { "index": 0, "codec_type": "video", "width": 1280, "height": 720, "avg_frame_rate": "30/1",
+              "tags": { "BPS": "3000000" } },
+            { "index": 1, "codec_type": "audio", "sample_rate": "48000", "channels": 2 }
+        ],
+        "format": { "duration": "30.000000", "bit_rate": "9000000" }
+    })", capped);
+
+    QCOMPARE(capped.audioBitrateKbps, 320);
+}
+
+//webm from a browser : no bitrate anywhere
+void TestFfprobe::unknownAudioBitrate(){
+    VideoInfo info;
+    readFfprobeOutput(R"({
+        "streams": [
+            { "index": 0, "codec_type": "video", "width": 1920, "height": 1080, "avg_frame_rate": "30/1", "bit_rate": "N/A" },
+            { "index": 1, "codec_type": "audio", "sample_rate": "48000", "channels": 2, "bit_rate": "N/A" }
+        ],
+        "format": { "duration": "15.000000" }
+    })", info);
+
+    QVERIFY(info.audioBitrateKbps > 0);
+    QCOMPARE(info.audioBitrateKbps, 128);
+}
+
+void TestFfprobe::noAudio(){
+    VideoInfo info;
+    readFfprobeOutput(R"({
+        "streams": [
+            { "index": 0, "codec_type": "video", "width": 1920, "height": 1080, "avg_frame_rate": "60/1", "tags": { "BPS": "8000000" } }
+        ],
+        "format": { "duration": "15.000000", "bit_rate": "8000000" }
+    })", info);
+
+    QCOMPARE(info.audioBitrateKbps, 0);
+}
+
+QTEST_GUILESS_MAIN(TestFfprobe)
+#include "tst_ffprobe.moc"
@@ -0,0 +1,66 @@
+#include <QtTest>
+#include <QTemporaryDir>
+#include "joblog.h"
+
+//Several processes writing in the same log, like the parts of a split video encoded in parallel
+class TestJobLog : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void linesSplitBetweenChunks();
+    void interleavedSources();
+    void closedSourceKeepsItsLastLine();
+
+private:
+    QTemporaryDir folder;
+};
+
+void TestJobLog::linesSplitBetweenChunks(){
+    JobLog log(folder.filePath("split.log"), 8);
+
+    log.append("Input #0, mov,mp4");
+    log.append(" from 'clip.mp4':\nframe=  10 fps=0.0 time=00:00:00.");
+    log.append("33 speed=1x\r");
+
+    QCOMPARE(log.tail(8), QStringList({ "Input #0, mov,mp4 from 'clip.mp4':" }));
+    QCOMPARE(log.lastProgressLine(), QString("frame=  10 fps=0.0 time=00:00:00.33 speed=1x"));
+}
+
+void TestJobLog::interleavedSources(){
+    JobLog log(folder.filePath("parallel.log"), 8);
+    QObject part1;
+    QObject part2;
+
+    //Chunks cut in the middle of the lines, one process after the other
+    log.append("frame=  50 fps= 30 time=00:00:", &part1);
+    log.append("frame= 400 fps=120 time=00:00:", &part2);
+    log.append("01.66 speed=1x\r[libx264 @ 0x1] error of part 1", &part1);
+    log.append("13.33 speed=4x\r[libx264 @ 0x2] line of ", &part2);
+    log.append("\n", &part1);
+    log.append("part 2\n", &part2);
+
+    QCOMPARE(log.lastProgressLine(&part1), QString("frame=  50 fps= 30 time=00:00:01.66 speed=1x"));
+    QCOMPARE(log.lastProgressLine(&part2), QString("frame= 400 fps=120 time=00:00:13.33 speed=4x"));
+
+    QCOMPARE(log.tail(4, &part1), QStringList({ "[libx264 @ 0x1] error of part 1" }));
+    QCOMPARE(log.tail(4, &part2), QStringList({ "[libx264 @ 0x2] line of part 2" }));
+    QCOMPARE(log.tail(4).count(), 2);
+}
+
+void TestJobLog::closedSourceKeepsItsLastLine(){
+    JobLog log(folder.filePath("closed.log"), 8);
+    QObject process;
+
+    log.append("Conversion failed!", &process);
+    QVERIFY(log.tail(4, &process).isEmpty());
+
+    //The line without its end is kept, the state of the source is forgotten
+    log.closeSource(&process);
+    QCOMPARE(log.tail(4), QStringList({ "Conversion failed!" }));
+    QVERIFY(log.tail(4, &process).isEmpty());
+    QVERIFY(log.lastProgressLine(&process).isEmpty());
+}
+
+QTEST_GUILESS_MAIN(TestJobLog)
+#include "tst_joblog.moc"
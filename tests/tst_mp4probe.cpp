@@ -0,0 +1,229 @@
+#include <QtTest>
+#include <QTemporaryDir>
+#include <QtEndian>
+#include "mp4probe.h"
+
+//VideoInfo read from the boxes of small MP4 files built here, a 10 s 1920x1080 30 fps video with a 128 kbps audio
+class TestMp4Probe : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+
+    void version0Times();
+    void version1Times();
+    void largeSizeBox();
+    void boxUntilTheEnd();
+    void brokenBoxes();
+    void fragmentedFile();
+    void notAnMp4();
+
+private:
+    //Writes the boxes into a file of the temporary folder and reads it
+    bool probe(const QByteArray &content, VideoInfo &info);
+
+    QTemporaryDir folder;
+    int fileIndex = 0;
+};
+
+static QByteArray be16(quint16 value){
+    QByteArray bytes(2, 0);
+    qToBigEndian(value, bytes.data());
+    return bytes;
+}
+
+static QByteArray be32(quint32 value){
+    QByteArray bytes(4, 0);
+    qToBigEndian(value, bytes.data());
+    return bytes;
+}
+
+static QByteArray be64(quint64 value){
+    QByteArray bytes(8, 0);
+    qToBigEndian(value, bytes.data());
+    return bytes;
+}
+
+static QByteArray box(const char *type, const QByteArray &content){
+    return be32(8 + content.size()) + QByteArray(type, 4) + content;
+}
+
+//mvhd and mdhd start the same way : version, flags, creation and modification times, timescale, duration
+static QByteArray timesBox(const char *type, int version, quint32 timescale, quint64 duration){
+    QByteArray content;
+    if (version == 1){
+        content = be32(0x01000000) + be64(0) + be64(0) + be32(timescale) + be64(duration);
+    }else{
+        content = be32(0) + be32(0) + be32(0) + be32(timescale) + be32(duration);
+    }
+    return box(type, content + QByteArray(80, 0));
+}
+
+static QByteArray handlerBox(const char *handler){
+    return box("hdlr", be32(0) + be32(0) + QByteArray(handler, 4) + QByteArray(12, 0) + QByteArray("\0", 1));
+}
+
+//Runs of { sample count, sample duration }
+static QByteArray sttsBox(const QList<QPair<quint32, quint32>> &runs){
+    QByteArray content = be32(0) + be32(runs.count());
+    for (const auto &run : runs) content += be32(run.first) + be32(run.second);
+    return box("stts", content);
+}
+
+static QByteArray stszBox(quint32 sampleSize, quint32 sampleCount, const QList<quint32> &sizes = {}){
+    QByteArray content = be32(0) + be32(sampleSize) + be32(sampleCount);
+    for (quint32 size : sizes) content += be32(size);
+    return box("stsz", content);
+}
+
+static QByteArray trak(int version, const char *handler, quint32 timescale, quint64 duration, const QByteArray &stbl){
+    //Display size in 16.16 at the end of a version 0 tkhd
+    QByteArray tkhd = box("tkhd", be32(0) + QByteArray(72, 0) + be32(1920 << 16) + be32(1080 << 16));
+
+    QByteArray mdia = box("mdia", timesBox("mdhd", version, timescale, duration)
+                                  + handlerBox(handler)
+                                  + box("minf", box("stbl", stbl)));
+    return box("trak", tkhd + mdia);
+}
+
+//30 fps in a 15360 timescale, the frames of the sample entry are in the coded size
+static QByteArray videoTrak(int version){
+    QByteArray avc1 = box("avc1", QByteArray(6, 0) + be16(1) + QByteArray(16, 0) + be16(1920) + be16(1080) + QByteArray(50, 0));
+    QByteArray stsd = box("stsd", be32(0) + be32(1) + avc1);
+
+    //Two runs to check that they add up, 300 frames of 512
+    QList<quint32> sizes(300, 20000);
+    QByteArray stbl = stsd + sttsBox({ { 200, 512 }, { 100, 512 } }) + stszBox(0, 300, sizes);
+
+    return trak(version, "vide", 15360, 153600, stbl);
+}
+
+//400 samples of 400 bytes over 10 s : 128 kbps
+static QByteArray audioTrak(int version){
+    QByteArray stbl = box("stsd", be32(0) + be32(0)) + sttsBox({ { 400, 1200 } }) + stszBox(400, 400);
+    return trak(version, "soun", 48000, 480000, stbl);
+}
+
+static QByteArray moov(int version, const QByteArray &extra = QByteArray()){
+    return box("moov", timesBox("mvhd", version, 1000, 10000) + videoTrak(version) + audioTrak(version) + extra);
+}
+
+static const QByteArray ftyp = box("ftyp", QByteArray("isom") + be32(512) + QByteArray("isomavc1"));
+
+void TestMp4Probe::initTestCase(){
+    QVERIFY(folder.isValid());
+}
+
+bool TestMp4Probe::probe(const QByteArray &content, VideoInfo &info){
+    QFile file(folder.filePath("clip" + QString::number(++fileIndex) + ".mp4"));
+    if (!file.open(QIODevice::WriteOnly) || file.write(content) != content.size()) return false;
+    file.close();
+
+    return readMp4Info(file.fileName(), info);
+}
+
+static void compareInfo(const VideoInfo &info, qint64 fileSize){
+    QCOMPARE(info.duration, 10.0);
+    QCOMPARE(info.fps, 30.0);
+    QCOMPARE(info.width, 1920);
+    QCOMPARE(info.height, 1080);
+    QCOMPARE(info.audioBitrateKbps, 128);
+    QCOMPARE(info.sourceBitrateKbps, int(fileSize * 8 / 10.0 / 1000));
+}
+
+void TestMp4Probe::version0Times(){
+    QByteArray content = ftyp + moov(0) + box("mdat", QByteArray(6000, 0));
+
+    VideoInfo info;
+    QVERIFY(probe(content, info));
+    compareInfo(info, content.size());
+}
+
+void TestMp4Probe::version1Times(){
+    QByteArray content = ftyp + moov(1) + box("mdat", QByteArray(6000, 0));
+
+    VideoInfo info;
+    QVERIFY(probe(content, info));
+    compareInfo(info, content.size());
+}
+
+//The mdat of big files has a 64 bits size, the moov after it must still be found
+void TestMp4Probe::largeSizeBox(){
+    QByteArray frames(6000, 0);
+    QByteArray mdat = be32(1) + QByteArray("mdat") + be64(16 + frames.size()) + frames;
+    QByteArray content = ftyp + mdat + moov(0);
+
+    VideoInfo info;
+    QVERIFY(probe(content, info));
+    compareInfo(info, content.size());
+}
+
+//A size of 0 : the last box goes until the end of the file
+void TestMp4Probe::boxUntilTheEnd(){
+    QByteArray moovBox = moov(0);
+    moovBox.replace(0, 4, be32(0));
+    QByteArray content = ftyp + box("mdat", QByteArray(6000, 0)) + moovBox;
+
+    VideoInfo info;
+    QVERIFY(probe(content, info));
+    compareInfo(info, content.size());
+}
+
+//Sizes going past their parent or past the data of the box are never followed, the VideoInfo is left as it was
+void TestMp4Probe::brokenBoxes(){
+    VideoInfo untouched;
+    untouched.duration = 42;
+
+    //File cut in the middle of the moov (recording still in progress)
+    QByteArray whole = ftyp + moov(0);
+    VideoInfo info = untouched;
+    QVERIFY(!probe(whole.left(whole.size() - 100), info));
+    QCOMPARE(info.duration, 42.0);
+
+    //A child bigger than its parent : the trak is walked until it, its mdia after it is never reached
+    QByteArray oversized = moov(0);
+    int tkhd = oversized.indexOf("tkhd") - 4;
+    oversized.replace(tkhd, 4, be32(1000000));
+    info = untouched;
+    QVERIFY(!probe(ftyp + oversized + box("mdat", QByteArray(6000, 0)), info));
+    QCOMPARE(info.duration, 42.0);
+
+    //More runs in stts and more sizes in stsz than the boxes hold
+    QByteArray runs = moov(0);
+    int stts = runs.indexOf("stts") + 8;
+    runs.replace(stts, 4, be32(0x10000000));
+    info = untouched;
+    QVERIFY(!probe(ftyp + runs, info));
+
+    QByteArray sizes = moov(0);
+    int stsz = sizes.indexOf("stsz") + 12;
+    sizes.replace(stsz, 4, be32(0x10000000));
+    info = untouched;
+    QVERIFY(!probe(ftyp + sizes, info));
+    QCOMPARE(info.duration, 42.0);
+
+    //64 bits size with its header cut
+    info = untouched;
+    QVERIFY(!probe(ftyp + be32(1) + QByteArray("mdat") + be32(0), info));
+}
+
+//The samples of a fragmented file are in its moof boxes, ffprobe has to read it
+void TestMp4Probe::fragmentedFile(){
+    QByteArray mvex = box("mvex", box("trex", QByteArray(24, 0)));
+    QByteArray content = ftyp + moov(0, mvex) + box("moof", QByteArray(100, 0)) + box("mdat", QByteArray(6000, 0));
+
+    VideoInfo info;
+    QVERIFY(!probe(content, info));
+    QCOMPARE(info.duration, 0.0);
+}
+
+void TestMp4Probe::notAnMp4(){
+    VideoInfo info;
+    QVERIFY(!probe(QByteArray("\x1A\x45\xDF\xA3") + QByteArray(100, 0), info));
+    QVERIFY(!probe(box("abcd", QByteArray(100, 0)) + moov(0), info));
+    QVERIFY(!probe(QByteArray(), info));
+}
+
+QTEST_GUILESS_MAIN(TestMp4Probe)
+#include "tst_mp4probe.moc"
@@ -0,0 +1,149 @@
+#include <QtTest>
+#include "compressionengine.h"
+#include "encoderbackend.h"
+
+//Commands of the last pass of a video with several sizes
+class TestPassArgs : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void namedStatsShareOneCommand();
+    void ffmpegStatsOneCommandPerSize();
+    void intermediateCopyMappedForEverySize();
+    void samePresetForBothPasses();
+
+private:
+    static VideoJob tieredJob(const QString &encoder);
+};
+
+static const QString prefix = "/cache/tempffmpeg/ffmpeg_pass";
+
+VideoJob TestPassArgs::tieredJob(const QString &encoder){
+    VideoJob job;
+    job.inputPath = "/videos/clip.mp4";
+    job.outputPath = "/out/clip_8MB.mp4";
+    job.encoder = encoder;
+    job.detectCrop = false;
+    job.decimate = false;
+
+    job.videoInfo.duration = 60;
+    job.videoInfo.fps = 30;
+    job.videoInfo.width = 1920;
+    job.videoInfo.height = 1080;
+    job.videoInfo.audioBitrateKbps = 128;
+    job.videoInfo.videoBitrateKbps = 900;
+
+    VideoTarget medium;
+    medium.outputPath = "/out/clip_25MB.mp4";
+    medium.videoBitrateKbps = 3200;
+
+    VideoTarget big;
+    big.outputPath = "/out/clip_50MB.mp4";
+    big.videoBitrateKbps = 6500;
+
+    job.extraTargets << medium << big;
+    return job;
+}
+
+//Value following the first occurrence of key from the given index
+static QString valueAfter(const QStringList &args, const QString &key, int from = 0){
+    int index = args.indexOf(key, from);
+    return index >= 0 && index + 1 < args.count() ? args.at(index + 1) : QString();
+}
+
+void TestPassArgs::namedStatsShareOneCommand(){
+    for (const QString &encoder : { QString("libx264"), QString("libx265") }){
+        VideoJob job = tieredJob(encoder);
+        const QList<QStringList> commands = lastPassArgs(job, prefix);
+
+        //One decoding for the three sizes
+        QCOMPARE(commands.count(), 1);
+        const QStringList &args = commands.first();
+        QCOMPARE(args.count("-i"), 1);
+
+        QStringList outputs = { job.outputPath, job.extraTargets.at(0).outputPath, job.extraTargets.at(1).outputPath };
+        QStringList bitrates = { "900k", "3200k", "6500k" };
+
+        int from = 0;
+        for (int i = 0; i < outputs.count(); i++){
+            int end = args.indexOf(outputs.at(i), from);
+            QVERIFY2(end > from, qPrintable(encoder + " misses " + outputs.at(i)));
+
+            QStringList output = args.mid(from, end - from);
+            QCOMPARE(valueAfter(output, "-b:v"), bitrates.at(i));
+
+            //Every output reads the stats written by the pass 1, not a name made from its stream index
+            if (encoder == "libx264"){
+                QCOMPARE(valueAfter(output, "-pass"), QString("2"));
+                QCOMPARE(valueAfter(output, "-x264-params"), QString("stats=ffmpeg_pass.log"));
+                QVERIFY(!output.contains("-passlogfile"));
+            }else{
+                QCOMPARE(valueAfter(output, "-x265-params"), QString("pass=2:stats=ffmpeg_pass.x265.log"));
+            }
+
+            from = end + 1;
+        }
+
+        QCOMPARE(from, args.count());
+    }
+
+    //The pass 1 writes the same file
+    const EncoderBackend *x264 = EncoderBackend::byId("libx264");
+    QCOMPARE(valueAfter(x264->passArgs(1, 900, prefix), "-x264-params"), QString("stats=ffmpeg_pass.log"));
+    QVERIFY(x264->statsFiles(prefix).contains(prefix + ".log"));
+}
+
+void TestPassArgs::ffmpegStatsOneCommandPerSize(){
+    VideoJob job = tieredJob("libvpx-vp9");
+    const QList<QStringList> commands = lastPassArgs(job, prefix);
+
+    //ffmpeg names the stats after the stream index, only a single output finds the ones of the pass 1
+    QCOMPARE(commands.count(), 3);
+
+    QStringList outputs = { job.outputPath, job.extraTargets.at(0).outputPath, job.extraTargets.at(1).outputPath };
+    for (int i = 0; i < commands.count(); i++){
+        const QStringList &args = commands.at(i);
+        QCOMPARE(args.first(), QString("-y"));
+        QCOMPARE(args.last(), outputs.at(i));
+        QCOMPARE(args.count("-b:v"), 1);
+        QCOMPARE(valueAfter(args, "-pass"), QString("2"));
+        QCOMPARE(valueAfter(args, "-passlogfile"), prefix);
+    }
+}
+
+void TestPassArgs::intermediateCopyMappedForEverySize(){
+    VideoJob job = tieredJob("libx264");
+    job.intermediatePath = "/cache/tempffmpeg/intermediate.mkv";
+
+    const QList<QStringList> commands = lastPassArgs(job, prefix);
+    QCOMPARE(commands.count(), 1);
+
+    //The copy and the source for the audio, each output maps both
+    const QStringList &args = commands.first();
+    QCOMPARE(args.count("-i"), 2);
+    QCOMPARE(valueAfter(args, "-i"), job.intermediatePath);
+    QCOMPARE(args.count("0:v:0"), 3);
+    QCOMPARE(args.count("1:a:0?"), 3);
+}
+
+void TestPassArgs::samePresetForBothPasses(){
+    //The pass 2 refuses stats made with other settings
+    for (const QString &encoder : { QString("libx264"), QString("libx265") }){
+        const EncoderBackend *backend = EncoderBackend::byId(encoder);
+
+        for (const QString &preset : { QString(""), QString("fast") }){
+            QString pass1 = valueAfter(backend->passArgs(1, 900, prefix, preset), "-preset");
+            QString pass2 = valueAfter(backend->passArgs(2, 900, prefix, preset), "-preset");
+
+            QCOMPARE(pass1, pass2);
+            QCOMPARE(pass2, preset != "" ? preset : QString("slow"));
+        }
+    }
+
+    QCOMPARE(valueAfter(EncoderBackend::byId("libx265")->passArgs(2, 900, prefix), "-tag:v"), QString("hvc1"));
+    QVERIFY(!EncoderBackend::byId("libx265")->passArgs(1, 900, prefix).contains("-tag:v"));
+}
+
+QTEST_GUILESS_MAIN(TestPassArgs)
+#include "tst_passargs.moc"
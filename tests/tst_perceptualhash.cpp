@@ -0,0 +1,104 @@
+#include <QtTest>
+#include <QRandomGenerator>
+#include "perceptualhash.h"
+
+//Block sums of the hashes and the band index finding the duplicates
+class TestPerceptualHash : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void fastSumsMatchScalar();
+    void indexFindsEveryFrameWithinThreshold();
+    void indexFindsOneCloseFrame();
+};
+
+//Same frames every run
+static QRandomGenerator generator(20251018);
+
+static VideoHash randomHash(int frameCount){
+    VideoHash hash;
+    for (int i = 0; i < frameCount; i++){
+        hash.frames << generator.generate64();
+        hash.usable << true;
+    }
+    return hash;
+}
+
+//Flips one bit in each of the first bitCount bands of every frame, the worst case for the index : as few bands
+//as possible are left the same
+static VideoHash flipped(const VideoHash &hash, int bitCount){
+    VideoHash copy = hash;
+    for (int frame = 0; frame < copy.frames.size(); frame++){
+        for (int band = 0; band < bitCount; band++){
+            copy.frames[frame] ^= quint64(1) << (band * 8 + (frame + band) % 8);
+        }
+    }
+    return copy;
+}
+
+void TestPerceptualHash::fastSumsMatchScalar(){
+    for (int i = 0; i < 200; i++){
+        QImage gray(72, 64, QImage::Format_Grayscale8);
+
+        //The extremes first (a 8 bits sum would overflow), then random frames
+        for (int y = 0; y < gray.height(); y++){
+            uchar *line = gray.scanLine(y);
+            for (int x = 0; x < gray.width(); x++){
+                line[x] = (i == 0 ? 255 : i == 1 ? 0 : generator.bounded(256));
+            }
+        }
+
+        int fast[8][9];
+        int scalar[8][9];
+        blockSums(gray, fast);
+        blockSumsScalar(gray, scalar);
+
+        for (int row = 0; row < 8; row++){
+            for (int column = 0; column < 9; column++){
+                QCOMPARE(fast[row][column], scalar[row][column]);
+            }
+        }
+    }
+}
+
+void TestPerceptualHash::indexFindsEveryFrameWithinThreshold(){
+    const int threshold = static_cast<int>(DuplicateIndex::maxDistance);
+
+    DuplicateIndex index;
+    VideoHash original = randomHash(5);
+
+    //Other videos first, the match must come from the bands and not from the order
+    for (int i = 0; i < 200; i++){
+        index.add("other" + QString::number(i), randomHash(5));
+    }
+    index.add("original", original);
+
+    QCOMPARE(index.findDuplicate(original), QString("original"));
+
+    //threshold bits in each frame : one band of each frame is left the same
+    VideoHash close = flipped(original, threshold);
+    QCOMPARE(videoDistance(original, close), double(threshold));
+    QCOMPARE(index.findDuplicate(close), QString("original"));
+
+    //One more bit : too far, whatever the index finds
+    VideoHash far = flipped(original, threshold + 1);
+    QCOMPARE(videoDistance(original, far), double(threshold + 1));
+    QCOMPARE(index.findDuplicate(far), QString());
+}
+
+//The mean distance is under the threshold with a single frame sharing its bands, the others sharing none
+void TestPerceptualHash::indexFindsOneCloseFrame(){
+    DuplicateIndex index;
+    VideoHash original = randomHash(5);
+    index.add("original", original);
+
+    VideoHash copy = flipped(original, 8);
+    copy.frames[2] = original.frames.at(2);
+
+    QVERIFY(videoDistance(original, copy) <= DuplicateIndex::maxDistance);
+    QCOMPARE(index.findDuplicate(copy), QString("original"));
+}
+
+QTEST_GUILESS_MAIN(TestPerceptualHash)
+#include "tst_perceptualhash.moc"
@@ -0,0 +1,159 @@
+#include <QtTest>
+#include <QTemporaryDir>
+#include <QtMath>
+#include "compressionengine.h"
+#include "encoderbackend.h"
+
+//Size limit shared by the whole list : the split of the bits and the complexity read from the stats of the pass 1
+class TestSizeSplit : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+
+    void splitByWeights();
+    void minimumGrantedWhenItFits();
+    void minimumNotGrantedWhenItDoesnt();
+    void audioDoesntFit();
+    void x264Stats();
+    void x265Stats();
+    void pixelsWhenAnEncoderHasNoStats();
+
+private:
+    //Writes the stats file of the encoder and returns the prefix of the job
+    QString writeStats(const QString &encoder, const QString &name, const QByteArray &content);
+
+    QTemporaryDir folder;
+};
+
+//720p30 with a 128 kbps audio : 552 kbps minimum for the video
+static VideoJob clip(const QString &encoder = "libx264"){
+    VideoJob job;
+    job.inputPath = "/videos/clip.mp4";
+    job.encoder = encoder;
+    job.videoInfo.duration = 60;
+    job.videoInfo.fps = 30;
+    job.videoInfo.width = 1280;
+    job.videoInfo.height = 720;
+    job.videoInfo.audioBitrateKbps = 128;
+    return job;
+}
+
+static const double audioBits = 128000.0 * 60;
+static const double minimumBits = 552000.0 * 60;
+
+//targetBits are rounded down from the split
+static bool closeTo(long long unsigned bits, double expected){
+    return qAbs(static_cast<double>(bits) - expected) <= 1;
+}
+
+//Two frames needing the same bits at a common quantizer : 1000 bits at q 12, and half of it 6 qp higher
+static const QByteArray x264Lines =
+    "#options: 1280x720 fps=30/1 timebase=1/30 bitdepth=8 cabac=1 ref=3 deblock=1:0:0 analyse=0x3:0x113 me=hex\n"
+    "in:0 out:0 type:I dur:2 cpts:0 q:12.00 aq:11.50 tex:800 mv:150 misc:50 imb:3600 pmb:0 smb:0 d:- ref:;\n"
+    "in:1 out:1 type:P dur:2 cpts:2 q:18.00 aq:17.50 tex:300 mv:150 misc:50 imb:10 pmb:3000 smb:590 d:- ref:0 ;\n";
+
+static const QByteArray x265Lines =
+    "#options: cpuid=1111039 frame-threads=3 wpp numa-pools=8 pmode no-pme\n"
+    "in:0 out:0 type:I q:12.00 q-aq:11.80 q-noVbv:12.00 q-Rceq:100.00 tex:800 mv:150 misc:50 icu:3600.00 pcu:0.00 scu:0.00 sc:0 ;\n"
+    "in:1 out:1 type:P q:18.00 q-aq:17.80 q-noVbv:18.00 q-Rceq:100.00 tex:300 mv:150 misc:50 icu:10.00 pcu:3000.00 scu:590.00 sc:0 ;\n";
+
+//1000 bits at qscale 0.85 (q 12), then 500 bits at qscale 1.7 (q 18), each frame weighs complexity^0.6
+static const double expectedComplexity = 2 * qPow(850, 0.6);
+
+void TestSizeSplit::initTestCase(){
+    QVERIFY(folder.isValid());
+}
+
+QString TestSizeSplit::writeStats(const QString &encoder, const QString &name, const QByteArray &content){
+    QString prefix = folder.filePath(name);
+
+    QFile file(encoder == "libx265" ? prefix + ".x265.log" : prefix + ".log");
+    if (file.open(QIODevice::WriteOnly)) file.write(content);
+
+    return prefix;
+}
+
+void TestSizeSplit::splitByWeights(){
+    QList<VideoJob> jobs = { clip(), clip() };
+    QVERIFY(splitSizeLimit(jobs, { 1, 3 }, 2 * audioBits + 400000000));
+
+    QVERIFY(closeTo(jobs.at(0).targetBits, audioBits + 100000000));
+    QVERIFY(closeTo(jobs.at(1).targetBits, audioBits + 300000000));
+}
+
+//The simple clip would get 2 Mb for its video, it gets its minimum and the other one what's left
+void TestSizeSplit::minimumGrantedWhenItFits(){
+    QList<VideoJob> jobs = { clip(), clip() };
+    QCOMPARE(jobs.at(0).minimumVideoBitrateKbps(), 552);
+
+    QVERIFY(splitSizeLimit(jobs, { 1, 99 }, 2 * audioBits + 200000000));
+
+    QVERIFY(closeTo(jobs.at(0).targetBits, audioBits + minimumBits));
+    QVERIFY(closeTo(jobs.at(1).targetBits, audioBits + 200000000 - minimumBits));
+}
+
+//Both minimums don't fit : every job simply gets its share of the weights
+void TestSizeSplit::minimumNotGrantedWhenItDoesnt(){
+    QList<VideoJob> jobs = { clip(), clip() };
+    QVERIFY(2 * minimumBits > 50000000);
+
+    QVERIFY(splitSizeLimit(jobs, { 1, 99 }, 2 * audioBits + 50000000));
+
+    QVERIFY(closeTo(jobs.at(0).targetBits, audioBits + 500000));
+    QVERIFY(closeTo(jobs.at(1).targetBits, audioBits + 49500000));
+}
+
+void TestSizeSplit::audioDoesntFit(){
+    QList<VideoJob> jobs = { clip(), clip() };
+    QVERIFY(!splitSizeLimit(jobs, { 1, 1 }, 2 * audioBits));
+}
+
+void TestSizeSplit::x264Stats(){
+    const EncoderBackend *x264 = EncoderBackend::byId("libx264");
+
+    QString prefix = writeStats("libx264", "x264", x264Lines);
+    QVERIFY(qAbs(x264->statsComplexity(prefix) - expectedComplexity) < 1e-6);
+
+    //No stats, or only the options line
+    QCOMPARE(x264->statsComplexity(folder.filePath("missing")), -1.0);
+    QCOMPARE(x264->statsComplexity(writeStats("libx264", "x264empty", x264Lines.left(x264Lines.indexOf('\n') + 1))), -1.0);
+}
+
+void TestSizeSplit::x265Stats(){
+    const EncoderBackend *x265 = EncoderBackend::byId("libx265");
+
+    QString prefix = writeStats("libx265", "x265", x265Lines);
+    QVERIFY(qAbs(x265->statsComplexity(prefix) - expectedComplexity) < 1e-6);
+    QCOMPARE(x265->statsComplexity(folder.filePath("missing")), -1.0);
+}
+
+void TestSizeSplit::pixelsWhenAnEncoderHasNoStats(){
+    //Every encoder tells its complexity, the second clip is twice as complex
+    QList<VideoJob> jobs = { clip("libx264"), clip("libx265") };
+    jobs[0].statsPrefix = writeStats("libx264", "first", x264Lines);
+    jobs[1].statsPrefix = writeStats("libx265", "second", x265Lines + x265Lines.mid(x265Lines.indexOf('\n') + 1));
+
+    bool fromStats = false;
+    QVector<double> weights = sizeWeights(jobs, &fromStats);
+    QVERIFY(fromStats);
+    QCOMPARE(weights.count(), 2);
+    QVERIFY(qAbs(weights.at(1) / weights.at(0) - 2) < 1e-6);
+
+    //SVT-AV1 and VP9 have no complexity : the pixels of every job are used, not a mix of both
+    for (const QString &encoder : { QString("libsvtav1"), QString("libvpx-vp9") }){
+        QList<VideoJob> mixed = jobs;
+        mixed << clip(encoder);
+        mixed[2].videoInfo.duration = 120;
+        mixed[2].statsPrefix = folder.filePath("third");
+
+        weights = sizeWeights(mixed, &fromStats);
+        QVERIFY(!fromStats);
+        QCOMPARE(weights, pixelWeights(mixed));
+        QVERIFY(qAbs(weights.at(2) / weights.at(0) - 2) < 1e-6);
+    }
+}
+
+QTEST_GUILESS_MAIN(TestSizeSplit)
+#include "tst_sizesplit.moc"
@@ -0,0 +1,134 @@
+#include <QtTest>
+#include <QtEndian>
+#include <QTemporaryDir>
+#include "videoscanner.h"
+
+//Videos recognized by their first bytes, and folders walked by the scanner
+class TestVideoScanner : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void isoBrands();
+    void quickTimeWithoutFtyp();
+    void otherContainers();
+    void scanAfterCancel();
+};
+
+static QByteArray be32(quint32 value){
+    QByteArray bytes(4, 0);
+    qToBigEndian(value, bytes.data());
+    return bytes;
+}
+
+static QByteArray box(const char *type, int contentSize){
+    return be32(8 + contentSize) + QByteArray(type, 4) + QByteArray(contentSize, 0);
+}
+
+void TestVideoScanner::isoBrands(){
+    QByteArray mp4 = be32(24) + "ftypisom" + be32(512) + "isomavc1";
+    QCOMPARE(detectContainer(mp4, 100000), QString("mp4"));
+
+    QByteArray mov = be32(20) + "ftypqt  " + be32(0) + "qt  ";
+    QCOMPARE(detectContainer(mov, 100000), QString("mov"));
+
+    QByteArray heic = be32(24) + "ftypheic" + be32(0) + "mif1heic";
+    QCOMPARE(detectContainer(heic, 100000), QString());
+}
+
+void TestVideoScanner::quickTimeWithoutFtyp(){
+    //Straight the moov or the mdat, or after a few padding boxes
+    QCOMPARE(detectContainer(box("moov", 200), 100000), QString("mov"));
+    QCOMPARE(detectContainer(box("mdat", 200), 100000), QString("mov"));
+    QCOMPARE(detectContainer(box("wide", 0) + box("mdat", 200), 100000), QString("mov"));
+    QCOMPARE(detectContainer(box("free", 40) + box("skip", 8) + box("moov", 100), 100000), QString("mov"));
+
+    //64 bits size of a big mdat
+    QByteArray bigMdat = be32(1) + "mdat" + be32(1) + be32(0) + QByteArray(100, 0);
+    QCOMPARE(detectContainer(bigMdat, qint64(1) << 33), QString("mov"));
+    QCOMPARE(detectContainer(bigMdat, 100000), QString());
+
+    //Any binary with these letters at the 5th byte
+    QByteArray random = QByteArray("\xde\xad\xbe\xef", 4) + "free" + QByteArray(100, 1);
+    QCOMPARE(detectContainer(random, 100000), QString());
+    QCOMPARE(detectContainer(be32(3) + "mdat" + QByteArray(100, 0), 100000), QString());
+
+    //Bigger than the file
+    QCOMPARE(detectContainer(box("mdat", 200), 100), QString());
+
+    //Padding not followed by the moov or the mdat
+    QCOMPARE(detectContainer(box("free", 8) + box("abcd", 100), 100000), QString());
+    QCOMPARE(detectContainer(box("wide", 0) + QByteArray(100, 0), 100000), QString());
+    QCOMPARE(detectContainer(box("free", 8) + QByteArray(4, 0), 100000), QString());
+
+    //Padding going past the bytes read : can't be told from any other file
+    QCOMPARE(detectContainer(box("skip", 200).left(100), 100000), QString());
+}
+
+void TestVideoScanner::otherContainers(){
+    QByteArray webm = QByteArray::fromHex("1a45dfa3") + QByteArray::fromHex("9f4286810142f7810142f2810442f381084282") + "\x84webm";
+    QCOMPARE(detectContainer(webm + QByteArray(20, 0), 100000), QString("webm"));
+
+    QByteArray avi = QByteArray("RIFF") + be32(1000) + "AVI LIST";
+    QCOMPARE(detectContainer(avi, 100000), QString("avi"));
+
+    QByteArray ts(188 * 3, 0);
+    ts[0] = ts[188] = ts[188 * 2] = 0x47;
+    QCOMPARE(detectContainer(ts, 100000), QString("mpegts"));
+
+    QCOMPARE(detectContainer(QByteArray("GIF89a") + QByteArray(100, 0), 100000), QString());
+}
+
+//Writes videoCount small QuickTime files in the folder
+static bool writeVideos(const QString &folder, int videoCount){
+    if (!QDir().mkpath(folder)) return false;
+
+    for (int i = 0; i < videoCount; i++){
+        QFile file(folder + "/video" + QString::number(i + 1) + ".bin");
+        if (!file.open(QIODevice::WriteOnly)) return false;
+        file.write(box("moov", 200));
+    }
+    return true;
+}
+
+//The tasks of the canceled scan can still be ending when the next one starts, the next one must never be dropped
+void TestVideoScanner::scanAfterCancel(){
+    QTemporaryDir folder;
+    QVERIFY(folder.isValid());
+
+    QString big = folder.filePath("big");
+    for (int i = 0; i < 200; i++){
+        QVERIFY(writeVideos(big + "/sub" + QString::number(i), 5));
+    }
+
+    QString small = folder.filePath("small");
+    QVERIFY(writeVideos(small, 3));
+
+    VideoScanner scanner;
+    QStringList found;
+    QList<int> finished;
+
+    //Queued, the signals come from the threads of the pool
+    QObject receiver;
+    connect(&scanner, &VideoScanner::videosFound, &receiver, [&](QStringList filePaths){ found << filePaths; });
+    connect(&scanner, &VideoScanner::finished, &receiver, [&](int videoCount){ finished << videoCount; });
+
+    for (int i = 0; i < 20; i++){
+        found.clear();
+        finished.clear();
+
+        scanner.scan(big);
+        scanner.cancel();
+        scanner.scan(small);
+
+        QTRY_COMPARE(finished, QList<int>{ 3 });
+
+        //Batches of the big folder sent before the cancel can be there too
+        QCOMPARE(found.filter(small).count(), 3);
+    }
+
+    scanner.cancel();
+}
+
+QTEST_GUILESS_MAIN(TestVideoScanner)
+#include "tst_videoscanner.moc"
@@ -1,3 +1,391 @@
+#include "videojob.h"
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QJsonArray>
+#include <QRegularExpression>
+#include <QtMath>
 
+//Under this part of the pixels removed, the crop is not worth it
+static const double minCropGain = 0.02;
 
+//Under this part of static frames, dropping them saves too little for a variable fps output
+static const double minDuplicateRatio = 0.2;
 
+//Audio bitrate of a stream whose bitrate ffprobe can't tell, and max audio bitrate guessed from the whole file
+static const int defaultAudioBitrateKbps = 128;
+static const int maxGuessedAudioBitrateKbps = 320;
+
+bool VideoJob::isTrimmed() const{
+    return trimStart > 0 || trimEnd > 0;
+}
+
+double VideoJob::clipDuration() const{
+    double end = videoInfo.duration;
+
+    if (trimEnd > 0 && (end <= 0 || trimEnd < end)){
+        end = trimEnd;
+    }
+
+    double length = end - trimStart;
+    return length > 0 ? length : 0;
+}
+
+QStringList VideoJob::inputArgs() const{
+    QStringList args;
+
+    //-ss before -i makes ffmpeg jump straight to the keyframe before the start
+    //instead of decoding everything up to it, the frames in between are then dropped so the cut stays exact
+    if (trimStart > 0){
+        args << "-ss" << QString::number(trimStart, 'f', 3);
+    }
+
+    //-t before -i stops reading the input once the clip is done, for every output of the command
+    if (isTrimmed()){
+        args << "-t" << QString::number(clipDuration(), 'f', 3);
+    }
+
+    args << "-i" << inputPath;
+
+    return args;
+}
+
+double VideoJob::outputFps() const{
+    double fps = videoInfo.fps;
+
+    if (fpsLimit > 0 && fpsLimit < fps) fps = fpsLimit;
+    if (plannedFpsLimit > 0 && plannedFpsLimit < fps) fps = plannedFpsLimit;
+
+    return fps;
+}
+
+int VideoJob::videoBitrateFor(long long unsigned bits) const{
+    double duration = clipDuration();
+    if (duration <= 0) return 0;
+
+    //Calculating the video bitratebps in order to re encode the video with this limit of bits for the video
+    //While keeping the audio untouched
+    double audioBits = videoInfo.audioBitrateKbps * 1000.0 * duration;
+    if (audioBits >= bits) return 0;
+
+    long long unsigned videoBits = bits - audioBits;
+    long long unsigned videoBitratebps = videoBits / duration;
+
+    return videoBitratebps / 1000;
+}
+
+//Bits per pixel under which even x264 turns everything into blocks
+static const double minBitsPerPixel = 0.02;
+static const int minVideoBitrateKbps = 100;
+
+bool VideoJob::isDecimated() const{
+    return decimate && videoInfo.duplicateRatio >= minDuplicateRatio;
+}
+
+double VideoJob::effectiveFps() const{
+    return outputFps() * (isDecimated() ? 1 - videoInfo.duplicateRatio : 1);
+}
+
+int VideoJob::outputWidth() const{
+    return videoInfo.cropWidth > 0 ? videoInfo.cropWidth : videoInfo.width;
+}
+
+int VideoJob::outputHeight() const{
+    return videoInfo.cropWidth > 0 ? videoInfo.cropHeight : videoInfo.height;
+}
+
+QStringList VideoJob::filterArgs() const{
+    QStringList filters;
+
+    if (videoInfo.cropWidth > 0){
+        filters << QString("crop=%1:%2:%3:%4")
+                       .arg(videoInfo.cropWidth).arg(videoInfo.cropHeight).arg(videoInfo.cropX).arg(videoInfo.cropY);
+    }
+
+    if (isDecimated()){
+        filters << decimateFilters();
+    }
+
+    if (filters.isEmpty()) return {};
+    return { "-vf", filters.join(",") };
+}
+
+QString VideoJob::decimateFilters() const{
+    return "fps=" + QString::number(outputFps()) + ",mpdecimate";
+}
+
+QStringList VideoJob::rateArgs() const{
+    //The frames left keep their timestamps, a static screen becomes a single frame shown for a long time
+    if (isDecimated()) return { "-fps_mode", "vfr" };
+
+    return { "-r", QString::number(videoInfo.fps) };
+}
+
+int VideoJob::minimumVideoBitrateKbps() const{
+    //The black bars cropped and the static frames dropped don't need any bit
+    double kbps = effectiveFps() * outputWidth() * outputHeight() * minBitsPerPixel / 1000;
+    return qMax(minVideoBitrateKbps, static_cast<int>(kbps));
+}
+
+bool VideoJob::computeEncodingSettings(){
+    videoInfo.videoBitrateKbps = videoBitrateFor(targetBits);
+    if (videoInfo.videoBitrateKbps <= 0) return false;
+
+    for (VideoTarget &target : extraTargets){
+        target.videoBitrateKbps = videoBitrateFor(target.targetBits);
+        if (target.videoBitrateKbps <= 0) return false;
+    }
+
+    //if we needs to reencode with custom output fps
+    videoInfo.fps = outputFps();
+
+    return true;
+}
+
+QVector<double> pixelWeights(const QList<VideoJob> &jobs){
+    QVector<double> weights;
+
+    //Same diminishing returns as the qcomp of x264
+    for (const VideoJob &job : jobs){
+        double frames = job.clipDuration() * job.effectiveFps();
+        weights << frames * qPow(static_cast<double>(job.outputWidth()) * job.outputHeight(), 0.6);
+    }
+
+    return weights;
+}
+
+bool splitSizeLimit(QList<VideoJob> &jobs, const QVector<double> &weights, long long unsigned totalBits){
+    int count = jobs.count();
+    double videoBits = totalBits;
+    QVector<double> audioBits(count);
+    QVector<double> minimumBits(count);
+
+    for (int i = 0; i < count; i++){
+        double duration = jobs.at(i).clipDuration();
+        audioBits[i] = jobs.at(i).videoInfo.audioBitrateKbps * 1000.0 * duration;
+        minimumBits[i] = jobs.at(i).minimumVideoBitrateKbps() * 1000.0 * duration;
+        videoBits -= audioBits.at(i);
+    }
+
+    if (videoBits <= 0) return false;
+
+    //The jobs under their minimum get it and the rest is split again between the others, until nobody is under
+    QVector<bool> atMinimum(count, false);
+    QVector<double> bits(count, 0);
+    bool changed = true;
+
+    while (changed){
+        changed = false;
+
+        double bitsLeft = videoBits;
+        double weightLeft = 0;
+        for (int i = 0; i < count; i++){
+            if (atMinimum.at(i)) bitsLeft -= minimumBits.at(i);
+            else weightLeft += weights.at(i);
+        }
+
+        for (int i = 0; i < count; i++){
+            if (atMinimum.at(i)){
+                bits[i] = minimumBits.at(i);
+            }else{
+                bits[i] = (weightLeft > 0 ? qMax(0.0, bitsLeft) * weights.at(i) / weightLeft : 0);
+            }
+
+            if (!atMinimum.at(i) && bits.at(i) < minimumBits.at(i)){
+                atMinimum[i] = true;
+                changed = true;
+            }
+        }
+
+        //Not even the minimums fit, every job simply gets its share
+        if (bitsLeft < 0 || !atMinimum.contains(false)){
+            double totalWeight = 0;
+            for (double weight : weights) totalWeight += weight;
+
+            for (int i = 0; i < count; i++){
+                bits[i] = (totalWeight > 0 ? videoBits * weights.at(i) / totalWeight : videoBits / count);
+            }
+            break;
+        }
+    }
+
+    for (int i = 0; i < count; i++){
+        jobs[i].targetBits = audioBits.at(i) + bits.at(i);
+    }
+
+    return true;
+}
+
+QStringList ffprobeArgs(const QString &inputPath){
+    QStringList args;
+    args << "-v" << "error"
+         << "-show_entries"
+         << "format=duration,bit_rate:stream=index,codec_type,avg_frame_rate,width,height,bit_rate,sample_rate,channels"
+            ":stream_tags=BPS,BPS-eng"
+         << "-of" << "json"
+         << inputPath;
+    return args;
+}
+
+//bit_rate of a stream in bits/s, 0 if unknown
+//Matroska and webm don't store it ("N/A"), mkvmerge and ffmpeg write it in the BPS tag of the stream instead
+static long long streamBitrate(const QJsonObject &stream){
+    long long bitrate = stream["bit_rate"].toString().toLongLong();
+    if (bitrate > 0) return bitrate;
+
+    QJsonObject tags = stream["tags"].toObject();
+    for (const QString &key : { QString("BPS"), QString("BPS-eng") }){
+        bitrate = tags[key].toString().toLongLong();
+        if (bitrate > 0) return bitrate;
+    }
+
+    return 0;
+}
+
+void readFfprobeOutput(const QByteArray &output, VideoInfo &info){
+    QJsonDocument doc = QJsonDocument::fromJson(output);
+
+    //Tries to retrieve the data from the generated json
+    if (!doc.isObject()) return;
+
+    QJsonObject root = doc.object();
+
+    // Duration
+    if (root.contains("format")) {
+        QJsonObject format = root["format"].toObject();
+        if (format.contains("duration"))
+            info.duration = format["duration"].toString().toDouble();
+        if (format.contains("bit_rate"))
+            info.sourceBitrateKbps = format["bit_rate"].toString().toLongLong() / 1000;
+    }
+
+    if (!root.contains("streams")) return;
+
+    // Video stream
+    QJsonArray streams = root["streams"].toArray();
+    long long videoBitrate = 0;
+    for (const QJsonValue& val : streams) {
+        QJsonObject stream = val.toObject();
+        QString codecType = stream["codec_type"].toString();
+        if (codecType == "video") {
+            videoBitrate = streamBitrate(stream);
+
+            // FPS
+            QString fpsStr = stream["avg_frame_rate"].toString(); //ex: "30000/1001"
+            QStringList parts = fpsStr.split('/');
+            if (parts.size() == 2)
+                info.fps = parts[0].toDouble() / parts[1].toDouble();
+
+            info.width = stream["width"].toInt();
+            info.height = stream["height"].toInt();
+            break;
+        }
+    }
+
+    // Audio stream
+    for (const QJsonValue& val : streams) {
+        QJsonObject stream = val.toObject();
+        QString codecType = stream["codec_type"].toString();
+        if (codecType == "audio") {
+            long long audioBitrate = streamBitrate(stream);
+
+            //No bitrate nor tag : what's left of the whole file once the video is taken out (capped, it also has the
+            //other streams and the container), or a bitrate high enough for most audio tracks
+            if (audioBitrate <= 0 && videoBitrate > 0 && info.sourceBitrateKbps * 1000ll > videoBitrate){
+                audioBitrate = qMin(info.sourceBitrateKbps * 1000ll - videoBitrate, maxGuessedAudioBitrateKbps * 1000ll);
+            }
+
+            info.audioBitrateKbps = (audioBitrate > 0 ? audioBitrate / 1000 : defaultAudioBitrateKbps); //kbps
+            break;
+        }
+    }
+}
+
+QStringList cropDetectArgs(const VideoJob &job){
+    QStringList args;
+
+    //reset=0 keeps the biggest area found on every frame, a single bright frame is enough to keep the whole picture
+    args << "-skip_frame" << "nokey"
+         << job.inputArgs()
+         << "-map" << "0:v:0"
+         << "-vf" << "cropdetect=limit=24:round=2:reset=0"
+         << "-an" << "-f" << "null" << "NUL";
+    return args;
+}
+
+bool readCropDetectOutput(const QStringList &lines, VideoInfo &info){
+    //ex : [Parsed_cropdetect_0 @ 0x...] x1:240 x2:1679 y1:0 y2:1079 w:1440 h:1080 x:240 y:0 pts:... crop=1440:1080:240:0
+    static const QRegularExpression cropRegex("crop=(\\d+):(\\d+):(\\d+):(\\d+)");
+
+    info.cropWidth = 0;
+
+    for (int i = lines.count() - 1; i >= 0; i--){
+        QRegularExpressionMatch match = cropRegex.match(lines.at(i));
+        if (!match.hasMatch()) continue;
+
+        int width = match.captured(1).toInt();
+        int height = match.captured(2).toInt();
+
+        double gain = 1 - static_cast<double>(width * height) / qMax(1, info.width * info.height);
+        if (width <= 0 || height <= 0 || gain < minCropGain) return false;
+
+        info.cropWidth = width;
+        info.cropHeight = height;
+        info.cropX = match.captured(3).toInt();
+        info.cropY = match.captured(4).toInt();
+        return true;
+    }
+
+    return false;
+}
+
+QStringList duplicateSampleArgs(const VideoJob &job, double start, double length){
+    QString filters = job.decimateFilters();
+
+    //Only the crop of the filters of the job, the static frames are dropped here whatever the ratio
+    VideoJob cropped = job;
+    cropped.decimate = false;
+    if (!cropped.filterArgs().isEmpty()){
+        filters = cropped.filterArgs().last() + "," + filters;
+    }
+
+    QStringList args;
+    args << "-ss" << QString::number(start, 'f', 3)
+         << "-t" << QString::number(length, 'f', 3)
+         << "-i" << job.inputPath
+         << "-map" << "0:v:0"
+         << "-vf" << filters
+         << "-fps_mode" << "vfr"
+         << "-an" << "-f" << "null" << "NUL";
+    return args;
+}
+
+double parseTimestamp(const QString &timestamp){
+    QStringList parts = timestamp.trimmed().split(':');
+
+    if (parts.isEmpty() || parts.size() > 3) return -1;
+
+    double seconds = 0;
+    for (const QString &part : parts){
+        bool ok = false;
+        double value = part.toDouble(&ok);
+        if (!ok || value < 0) return -1;
+
+        seconds = seconds * 60 + value;
+    }
+
+    return seconds;
+}
+
+QString formatTimestamp(double seconds){
+    //Rounded to the hundredth first, 59.996 must give 00:01:00.00 and not 00:00:60.00
+    long long hundredths = qRound64(qMax(0.0, seconds) * 100);
+
+    long long hours = hundredths / 360000;
+    long long minutes = (hundredths / 6000) % 60;
+    double rest = (hundredths % 6000) / 100.0;
+
+    return QString("%1:%2:%3")
+        .arg(hours, 2, 10, QChar('0'))
+        .arg(minutes, 2, 10, QChar('0'))
+        .arg(rest, 5, 'f', 2, QChar('0'));
+}
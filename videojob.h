@@ -2,20 +2,156 @@
 #define VIDEOJOB_H
 
 #include <QString>
+#include <QStringList>
+#include <QByteArray>
+#include <QList>
+#include <QVector>
 
 struct VideoInfo {
-    double duration;
-    double fps;
-    int width;
-    int height;
-    int audioBitrateKbps;
-    int videoBitrateKbps;
+    double duration = 0;
+    double fps = 0;
+    int width = 0;
+    int height = 0;
+    int audioBitrateKbps = 0;
+    int videoBitrateKbps = 0;
 
+    //Bitrate of the whole source file (video + audio)
+    int sourceBitrateKbps = 0;
+
+    //Part of the frame without the black bars, a cropWidth of 0 means nothing to crop
+    int cropWidth = 0;
+    int cropHeight = 0;
+    int cropX = 0;
+    int cropY = 0;
+
+    //Part of the frames that are the same as the previous one (static screens), from a few samples of the video
+    double duplicateRatio = 0;
+
+};
+
+//Another size of the same video, encoded by the same pass 2 as the main output
+struct VideoTarget {
+    long long unsigned targetBits = 0;
+    QString outputPath;
+    int videoBitrateKbps = 0;
 };
 
 struct VideoJob {
     QString inputPath;
     QString outputPath;
     VideoInfo videoInfo;
+
+    //Trim range in seconds, a trimEnd of 0 means until the end of the video
+    double trimStart = 0;
+    double trimEnd = 0;
+
+    //Id of the EncoderBackend used for this video
+    QString encoder = "libx264";
+
+    //Size limit of the output in bits, and max fps of the output (0 = keeps the fps of the video)
+    long long unsigned targetBits = 0;
+    int fpsLimit = 0;
+
+    //Other sizes of the video, they share the probing, the pass 1 and the decoding of the pass 2
+    QList<VideoTarget> extraTargets;
+
+    //Chosen by the deadline planner, empty = the usual preset of the encoder, 0 = no extra fps limit
+    QString preset;
+    int plannedFpsLimit = 0;
+
+    //Looks for black bars before encoding and crops them, a whole decoding of the clip more
+    bool detectCrop = false;
+
+    //Drops the frames identical to the previous one if the video has enough of them, the output then has a variable fps
+    //Made for screen recordings, three sample encodes more for each video
+    bool decimate = false;
+
+    //Splits the video into parts under the size limit when the whole video would get a too low bitrate
+    bool splitIntoParts = false;
+
+    //Lossless copy of the clip written by the pass 1 and read by the pass 2 instead of the source, empty = not used
+    QString intermediatePath;
+
+    //Stats files of the passes (path without extension), empty = the usual ones of the engine
+    //The jobs sharing a size limit each have their own, every pass 1 is done before the first pass 2
+    QString statsPrefix;
+
+    bool isTrimmed() const;
+
+    //Duration of the part of the video that will actually be encoded
+    double clipDuration() const;
+
+    //ffmpeg input args, seeks on the input (fast, from the nearest keyframe) then reads the exact length
+    QStringList inputArgs() const;
+
+    //fps of the output, the fps of the video capped by the fps limits
+    double outputFps() const;
+
+    //If the static frames are dropped, the video must have enough of them to be worth it
+    bool isDecimated() const;
+
+    //Mean fps actually encoded, without the dropped static frames
+    double effectiveFps() const;
+
+    //Size of the output, without the black bars
+    int outputWidth() const;
+    int outputHeight() const;
+
+    //ffmpeg video filter args of the output (crop of the black bars, static frames), empty if there's nothing to do
+    QStringList filterArgs() const;
+
+    //Filters dropping the static frames, the frames are first set to the output fps so that the ones duplicated
+    //by a variable fps source are dropped too
+    QString decimateFilters() const;
+
+    //ffmpeg args of the fps of the output : constant fps, or variable when the static frames are dropped
+    QStringList rateArgs() const;
+
+    //Video bitrate in kbps to fit the clip in the given size, 0 if not even the audio fits
+    int videoBitrateFor(long long unsigned bits) const;
+
+    //Under this video bitrate the output is not really watchable anymore, depends on the pixels per second
+    int minimumVideoBitrateKbps() const;
+
+    //Sets videoInfo.videoBitrateKbps, the bitrate of the extra targets and videoInfo.fps from the size and fps limits
+    //Returns false if one of the size limits can't be reached (not even enough bits for the audio)
+    bool computeEncodingSettings();
 };
+
+//Weight of each job to split a shared size limit when the pass 1 can't tell the complexity : the pixels to encode,
+//a frame with twice the pixels doesn't need twice the bits
+QVector<double> pixelWeights(const QList<VideoJob> &jobs);
+
+//Splits a size limit shared by every job into their targetBits : the audio first, then the video bits by weight,
+//the jobs that would be under their minimum video bitrate get it if the limit allows it
+//Returns false if not even the audio of every job fits
+bool splitSizeLimit(QList<VideoJob> &jobs, const QVector<double> &weights, long long unsigned totalBits);
+
+//ffprobe args to retrieve the VideoInfo of a file
+QStringList ffprobeArgs(const QString &inputPath);
+
+//Fills the VideoInfo from the json output of ffprobeArgs()
+//The audio bitrate falls back on the BPS tag (matroska, webm), then on the bitrate of the file without the video,
+//then on a usual bitrate, a video with audio never gets 0 kbps for it
+void readFfprobeOutput(const QByteArray &output, VideoInfo &info);
+
+//ffmpeg args finding the black bars of the clip, only the keyframes are decoded to be quick
+QStringList cropDetectArgs(const VideoJob &job);
+
+//Reads the last crop found in the log lines of cropDetectArgs() into the VideoInfo
+//The crop is ignored if it barely removes anything, returns true if the video will be cropped
+bool readCropDetectOutput(const QStringList &lines, VideoInfo &info);
+
+//ffmpeg args dropping the static frames of a part of the clip, the number of frames left is the "frame=" of its last progress line
+QStringList duplicateSampleArgs(const VideoJob &job, double start, double length);
+
+//Converts "hh:mm:ss.xx", "mm:ss" or plain seconds to seconds, returns -1 if invalid
+double parseTimestamp(const QString &timestamp);
+
+//Converts seconds to "hh:mm:ss.xx"
+QString formatTimestamp(double seconds);
+
 #endif // VIDEOJOB_H
+
+
+
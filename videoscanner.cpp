@@ -0,0 +1,155 @@
+#include "videoscanner.h"
+#include <QDir>
+#include <QDirIterator>
+#include <QFile>
+#include <QFileInfo>
+#include <QtEndian>
+
+//Videos sent at once, small enough for the list to fill up smoothly
+static const int batchSize = 64;
+
+//Bytes read at the start of every file, a few mpeg-ts packets
+static const int headerSize = 512;
+
+//ISO BMFF brands that are not videos : HEIF / AVIF images and m4a audio
+static const QList<QByteArray> nonVideoBrands = { "heic", "heix", "mif1", "msf1", "avif", "avis", "M4A ", "M4B ", "M4P " };
+
+//Old QuickTime files don't always start with a ftyp box, but with the moov, the mdat or some of these before them
+static const QList<QByteArray> quickTimePadding = { "wide", "free", "skip", "pnot" };
+
+VideoScanner::VideoScanner(QObject *parent)
+    : QObject(parent)
+{
+}
+
+VideoScanner::~VideoScanner(){
+    cancel();
+    pool.waitForDone();
+}
+
+void VideoScanner::scan(const QString &folder){
+    //The tasks of a canceled scan can still be ending, they keep their own state
+    if (!isScanning()){
+        currentScan = QSharedPointer<Scan>::create();
+    }
+
+    startFolder(currentScan, folder);
+}
+
+void VideoScanner::cancel(){
+    if (currentScan) currentScan->canceled.storeRelaxed(1);
+}
+
+bool VideoScanner::isScanning() const{
+    return currentScan && !currentScan->canceled.loadRelaxed() && currentScan->pendingFolders.loadRelaxed() > 0;
+}
+
+void VideoScanner::startFolder(const QSharedPointer<Scan> &scan, const QString &folder){
+    //Counted before the task starts, so that the count can't reach 0 while a subfolder is still waiting
+    scan->pendingFolders.ref();
+    pool.start([=](){ scanFolder(scan, folder); });
+}
+
+void VideoScanner::scanFolder(const QSharedPointer<Scan> &scan, const QString &folder){
+    QStringList videos;
+
+    QDirIterator it(folder, QDir::Files | QDir::Dirs | QDir::NoDotAndDotDot | QDir::Readable);
+    while (it.hasNext() && !scan->canceled.loadRelaxed()){
+        it.next();
+        QFileInfo info = it.fileInfo();
+
+        if (info.isDir()){
+            //A link to a parent folder would be walked forever
+            if (!info.isSymLink()) startFolder(scan, info.absoluteFilePath());
+            continue;
+        }
+
+        if (fileContainer(info.absoluteFilePath()).isEmpty()) continue;
+
+        videos << info.absoluteFilePath();
+        if (videos.count() >= batchSize){
+            scan->foundCount.fetchAndAddRelaxed(videos.count());
+            emit videosFound(videos);
+            videos.clear();
+        }
+    }
+
+    if (!videos.isEmpty() && !scan->canceled.loadRelaxed()){
+        scan->foundCount.fetchAndAddRelaxed(videos.count());
+        emit videosFound(videos);
+    }
+
+    //Last folder of the tree
+    if (!scan->pendingFolders.deref() && !scan->canceled.loadRelaxed()){
+        emit finished(scan->foundCount.loadRelaxed());
+    }
+}
+
+//A few bytes reading "free" or "mdat" are not enough : every box must have a size that fits in the file,
+//and the padding ones must lead to the moov or the mdat within the bytes read
+static bool isQuickTime(const QByteArray &header, qint64 fileSize){
+    const uchar *data = reinterpret_cast<const uchar*>(header.constData());
+    qint64 pos = 0;
+
+    while (pos + 8 <= header.size()){
+        quint64 size = qFromBigEndian<quint32>(data + pos);
+        QByteArray type = header.mid(pos + 4, 4);
+
+        //64 bits size, for the mdat of big files
+        if (size == 1 && pos + 16 <= header.size()) size = qFromBigEndian<quint64>(data + pos + 8);
+
+        if (size < 8 || size > quint64(fileSize - pos)) return false;
+        if (type == "moov" || type == "mdat") return true;
+        if (!quickTimePadding.contains(type)) return false;
+
+        pos += size;
+    }
+
+    return false;
+}
+
+QString detectContainer(const QByteArray &header, qint64 fileSize){
+    if (header.size() < 12) return "";
+
+    //ISO BMFF (mp4, mov, m4v, 3gp) : size then type of the first box
+    QByteArray boxType = header.mid(4, 4);
+    if (boxType == "ftyp"){
+        QByteArray brand = header.mid(8, 4);
+        if (nonVideoBrands.contains(brand)) return "";
+        return brand == "qt  " ? "mov" : "mp4";
+    }
+    if (isQuickTime(header, fileSize)) return "mov";
+
+    //EBML header, the DocType element (id 0x4282) tells matroska from webm
+    if (header.startsWith(QByteArray::fromHex("1a45dfa3"))){
+        int index = header.indexOf(QByteArray::fromHex("4282"));
+        if (index < 0 || index + 3 > header.size()) return "matroska";
+
+        //Size coded on one byte : 1xxxxxxx
+        uchar size = header.at(index + 2);
+        QByteArray docType = (size & 0x80 ? header.mid(index + 3, size & 0x7F) : QByteArray());
+        return docType == "webm" ? "webm" : "matroska";
+    }
+
+    if (header.startsWith("RIFF") && header.mid(8, 4) == "AVI ") return "avi";
+    if (header.startsWith("FLV\x01")) return "flv";
+    if (header.startsWith(QByteArray::fromHex("000001ba"))) return "mpeg";
+    if (header.startsWith(QByteArray::fromHex("3026b2758e66cf11"))) return "asf";
+
+    //MPEG-TS : a sync byte every 188 bytes, or every 192 bytes with the timecode of m2ts
+    if (header.size() >= 188 * 2 + 1 && header.at(0) == 0x47 && header.at(188) == 0x47 && header.at(188 * 2) == 0x47){
+        return "mpegts";
+    }
+    if (header.size() >= 192 * 2 + 5 && header.at(4) == 0x47 && header.at(196) == 0x47 && header.at(192 * 2 + 4) == 0x47){
+        return "mpegts";
+    }
+
+    return "";
+}
+
+QString fileContainer(const QString &filePath){
+    QFile file(filePath);
+    if (!file.open(QIODevice::ReadOnly)) return "";
+
+    return detectContainer(file.read(headerSize), file.size());
+}
@@ -0,0 +1,65 @@
+#ifndef VIDEOSCANNER_H
+#define VIDEOSCANNER_H
+
+#include <QObject>
+#include <QAtomicInt>
+#include <QByteArray>
+#include <QSharedPointer>
+#include <QString>
+#include <QStringList>
+#include <QThreadPool>
+
+//Finds the videos of a folder and of all its subfolders, every folder is listed by its own task of a thread pool
+//so that big trees (network drives, archives with thousands of folders) are walked in parallel
+//The videos are recognized by the first bytes of the files, not by their extension, and are sent by small batches
+//as soon as they are found, the list can be used long before the whole tree is walked
+class VideoScanner : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit VideoScanner(QObject *parent = nullptr);
+    ~VideoScanner();
+
+    //Walks the folder and its subfolders, can be called again while a scan runs (the folder is added to it)
+    void scan(const QString &folder);
+
+    //Stops the scan, the folders being listed are left as soon as possible and it sends nothing more
+    //A scan started right after is a new one, never mixed with the tasks of the canceled one still ending
+    void cancel();
+
+    bool isScanning() const;
+
+signals:
+    //Sent from the threads of the pool, the receivers get them in their own thread
+    void videosFound(QStringList filePaths);
+
+    //Every folder has been walked
+    void finished(int videoCount);
+
+private:
+    //State of one scan, shared by its tasks
+    struct Scan {
+        QAtomicInt pendingFolders = 0;
+        QAtomicInt foundCount = 0;
+        QAtomicInt canceled = 0;
+    };
+
+    void startFolder(const QSharedPointer<Scan> &scan, const QString &folder);
+    void scanFolder(const QSharedPointer<Scan> &scan, const QString &folder);
+
+    QThreadPool pool;
+
+    //Last scan started, only used from the thread of the scanner
+    QSharedPointer<Scan> currentScan;
+};
+
+//Container of a file from its first bytes : "mp4", "mov", "matroska", "webm", "avi", "mpegts", "flv", "mpeg" or "asf"
+//Empty if it doesn't look like a video (images and audio in an mp4 container included)
+//fileSize is the size of the whole file, the sizes of the boxes of a QuickTime file must fit in it
+QString detectContainer(const QByteArray &header, qint64 fileSize);
+
+//Reads the first bytes of the file for detectContainer()
+QString fileContainer(const QString &filePath);
+
+#endif // VIDEOSCANNER_H